@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace benchmarks {
+
+    /** Prints the average time of one call of @p f, measured over @p iterations calls
+     */
+    template <typename Function>
+    double measure(std::string const& name, std::uint64_t iterations, Function f) {
+        using clock = std::chrono::steady_clock;
+
+        const auto start = clock::now();
+        for (std::uint64_t i = 0; i != iterations; ++i)
+            f(i);
+        const std::chrono::duration<double, std::nano> time = clock::now() - start;
+
+        const double ns = time.count() / double(iterations);
+        std::cout << name << ": " << ns << " ns" << std::endl;
+        return ns;
+    }
+
+    // keeps the compiler from optimizing the measured computation away
+    template <typename T> void keep(T const& value) {
+        static volatile std::uint8_t sink;
+        sink = reinterpret_cast<volatile std::uint8_t const*>(&value)[0];
+    }
+
+} // namespace benchmarks
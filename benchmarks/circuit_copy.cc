@@ -0,0 +1,24 @@
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include "benchmark.h"
+#include <pcg/pcg_random.hpp>
+#include <solvers/individual.h>
+
+using test_circuit = circuit::circuit<8, 5, 1>;
+
+int main() {
+    pcg32 g(0);
+    circuit::basic_initializer ini{json(), circuit::fn_set{circuit::fn::XOR}};
+
+    solvers::individual<test_circuit, double> solution{test_circuit{16}};
+    solvers::individual<test_circuit, double> neighbour{test_circuit{16}};
+    ini.apply(solution.genotype, g);
+
+    std::cout << "circuit<8, 5, 1> takes " << sizeof(test_circuit) << " bytes" << std::endl;
+
+    benchmarks::measure("copy of an individual", 10000000, [&](std::uint64_t i) {
+        solution.genotype[0][i % 8].argument = std::uint8_t(i);
+        neighbour = solution;
+        benchmarks::keep(neighbour.genotype[0][(i + 1) % 8]);
+    });
+}
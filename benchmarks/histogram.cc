@@ -0,0 +1,64 @@
+#include "../eacirc/circuit/histogram.h"
+#include "../eacirc/statistics.h"
+#include "benchmark.h"
+#include <pcg/pcg_random.hpp>
+
+// counting of bytes by two_sample_chisqr before banked counts
+static void modulo_counts(std::vector<std::uint8_t> const& bytes, std::vector<std::uint64_t>& h) {
+    std::fill(h.begin(), h.end(), 0u);
+    for (std::uint8_t byte : bytes)
+        h[byte % h.size()]++;
+}
+
+int main() {
+    pcg32 g(0);
+    const std::size_t size = 16000; // 1000 test vectors of 16 bytes
+    const std::uint64_t iterations = 20000;
+
+    std::vector<std::uint8_t> uniform(size);
+    std::vector<std::uint8_t> skewed(size);
+    std::vector<std::uint8_t> constant(size, 7u);
+    for (std::size_t i = 0; i != size; ++i) {
+        uniform[i] = std::uint8_t(g());
+        skewed[i] = g() % 10 != 0 ? 3u : std::uint8_t(g());
+    }
+
+    struct distribution {
+        std::string name;
+        std::vector<std::uint8_t> const& bytes;
+    };
+    for (auto d : {distribution{"uniform", uniform},
+                   distribution{"skewed", skewed},
+                   distribution{"constant", constant}}) {
+        for (std::size_t categories : {std::size_t(8), std::size_t(12)}) {
+            const std::string name =
+                    d.name + " bytes, " + std::to_string(categories) + " categories";
+            std::vector<std::uint64_t> h(categories);
+
+            benchmarks::measure(name + ", modulo per byte", iterations, [&](std::uint64_t) {
+                modulo_counts(d.bytes, h);
+                benchmarks::keep(h[0]);
+            });
+
+            circuit::byte_counts counts;
+            benchmarks::measure(name + ", byte counts", iterations, [&](std::uint64_t) {
+                counts.clear();
+                counts.add(d.bytes.data(), d.bytes.size());
+                std::fill(h.begin(), h.end(), 0u);
+                counts.fold(h);
+                benchmarks::keep(h[0]);
+            });
+        }
+    }
+
+    // outputs of a mutated circuit, where some of the bytes and blocks are unchanged
+    std::vector<std::uint8_t> mutated(size);
+    for (std::size_t i = 0; i != size; ++i)
+        mutated[i] = (i / 32) % 8 == 0 || g() % 3 == 0 ? uniform[i] : std::uint8_t(g());
+
+    circuit::byte_counts counts;
+    benchmarks::measure("move of changed bytes", iterations, [&](std::uint64_t) {
+        counts.move(uniform.data(), mutated.data(), size);
+        benchmarks::keep(counts);
+    });
+}
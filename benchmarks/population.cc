@@ -0,0 +1,48 @@
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include "benchmark.h"
+#include <pcg/pcg_random.hpp>
+
+using test_circuit = circuit::circuit<8, 5, 1>;
+
+int main() {
+    pcg32 g(0);
+    circuit::basic_initializer ini{json(),
+                                   circuit::fn_set{circuit::fn::XOR,
+                                                   circuit::fn::AND,
+                                                   circuit::fn::NOT,
+                                                   circuit::fn::SHIL,
+                                                   circuit::fn::MASK}};
+
+    std::vector<test_circuit> population(32, test_circuit{16});
+    for (auto& circuit : population)
+        ini.apply(circuit, g);
+
+    // the smaller datasets are cached by the evaluator, the larger ones only referenced
+    for (std::size_t size : {std::size_t(1000), std::size_t(100000)}) {
+        dataset a{16, size};
+        dataset b{16, size};
+        for (auto vec : a)
+            for (auto& byte : vec)
+                byte = std::uint8_t(g());
+        for (auto vec : b)
+            for (auto& byte : vec)
+                byte = std::uint8_t(g());
+
+        circuit::categories_evaluator<test_circuit> eva{json{{"num-of-categories", 8}}};
+        eva.change_datasets(a, b);
+        const std::string name = std::to_string(size) + " test vectors, 32 circuits";
+        const std::uint64_t iterations = 1000000 / size + 1;
+
+        std::vector<double> scores(population.size());
+        benchmarks::measure(name + ", one by one", iterations, [&](std::uint64_t) {
+            for (std::size_t i = 0; i != population.size(); ++i)
+                scores[i] = eva.apply(population[i]);
+            benchmarks::keep(scores[0]);
+        });
+        benchmarks::measure(name + ", as a population", iterations, [&](std::uint64_t) {
+            eva.apply(population.begin(), population.end(), scores.begin());
+            benchmarks::keep(scores[0]);
+        });
+    }
+}
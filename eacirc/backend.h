@@ -1,10 +1,17 @@
 #pragma once
 
-#include <eacirc-core/dataset.h>
+#include "dataset_view.h"
 
 struct backend {
     virtual ~backend() = default;
 
-    virtual void train(dataset const& a, dataset const& b) = 0;
-    virtual double test(dataset const& a, dataset const& b) = 0;
+    virtual void train(dataset_view a, dataset_view b) = 0;
+    virtual double test(dataset_view a, dataset_view b) = 0;
+
+    /** Tests datasets too large to be held at once, given chunk by chunk between begin_test and
+     * end_test; the result is the same as of test on the concatenated chunks
+     */
+    virtual void begin_test() = 0;
+    virtual void test_chunk(dataset_view a, dataset_view b) = 0;
+    virtual double end_test() = 0;
 };
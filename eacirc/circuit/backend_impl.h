@@ -3,58 +3,230 @@
 #include "backend.h"
 #include "circuit.h"
 #include "genetics.h"
+#include "geometries.h"
+#include <eacirc-core/logger.h>
 #include <eacirc-core/memory.h>
 #include <fstream>
+#include <solvers/genetic_algorithm.h>
+#include <solvers/island_model.h>
 #include <solvers/local_search.h>
+#include <solvers/parallel_tempering.h>
 
 namespace circuit {
 
-    template <typename Circuit> struct global_search : backend {
-        template <typename Sseq>
-        global_search(unsigned tv_size, json const& config, Sseq&& seed)
-            : _function_set(config.at("function-set"))
-            , _num_of_generations(config.at("num-of-generations"))
-            , _solver(Circuit(tv_size),
-                      ini(config.at("initializer"), _function_set),
-                      mut(config.at("mutator"), _function_set),
-                      eva(config.at("evaluator")),
-                      std::forward<Sseq>(seed)) {}
-
-        ~global_search() {
-            {
-                std::ofstream out("scores.txt");
-                for (double score : _solver.scores())
-                    out << score << std::endl;
-            }
+    // writes the scores of the solver to a file and logs the counters of its evaluator
+    template <typename Solver>
+    void report_search(Solver const& solver, std::string const& scores_file) {
+        {
+            std::ofstream out(scores_file);
+            for (double score : solver.scores())
+                out << score << std::endl;
         }
 
-        void train(dataset const& a, dataset const& b) override {
-            _solver.reevaluate(a, b);
-            _solver.run(_num_of_generations);
+        auto const& cache = solver.evaluator().cache();
+        if (cache.enabled())
+            logger::info() << "score cache hits: " << cache.hits() << ", misses: " << cache.misses()
+                           << std::endl;
+
+        auto const& race = solver.evaluator().race();
+        if (race.enabled())
+            logger::info() << "racing rejections: " << race.rejections()
+                           << ", average fraction of data consumed per rejection: "
+                           << race.consumed_per_rejection() << std::endl;
+    }
+
+    // logs the counters specific to the solver
+    template <typename... Args>
+    void report_solver(solvers::local_search<Args...> const& solver) {
+        logger::info() << "evaluations: " << solver.num_of_evaluations()
+                       << ", skipped as neutral: " << solver.num_of_skipped_evaluations()
+                       << std::endl;
+    }
+
+    template <typename... Args>
+    void report_solver(solvers::genetic_algorithm<Args...> const& solver) {
+        logger::info() << "evaluations: " << solver.num_of_evaluations() << std::endl;
+    }
+
+    template <typename... Args>
+    void report_solver(solvers::island_model<Args...> const& solver) {
+        logger::info() << "evaluations: " << solver.num_of_evaluations()
+                       << ", skipped as neutral: " << solver.num_of_skipped_evaluations()
+                       << ", migrations: " << solver.num_of_migrations() << std::endl;
+    }
+
+    template <typename... Args>
+    void report_solver(solvers::parallel_tempering<Args...> const& solver) {
+        logger::info() << "evaluations: " << solver.num_of_evaluations()
+                       << ", skipped as neutral: " << solver.num_of_skipped_evaluations()
+                       << std::endl;
+
+        const auto rate = [](std::uint64_t part, std::uint64_t whole) {
+            return whole != 0 ? double(part) / double(whole) : 0.0;
+        };
+        auto const& levels = solver.levels();
+        for (std::size_t l = 0; l != levels.size(); ++l) {
+            const std::string exchanges =
+                    l + 1 == levels.size()
+                            ? ""
+                            : ", accepted exchanges with the next: " +
+                                      std::to_string(rate(levels[l].exchanges_accepted,
+                                                          levels[l].exchanges_tried));
+            logger::info() << "temperature " << solver.temperatures()[l]
+                           << ": accepted neighbours: "
+                           << rate(levels[l].accepted, levels[l].evaluated) << exchanges
+                           << std::endl;
+        }
+        for (std::size_t i = 0; i != levels.size(); ++i) {
+            auto const& replica = solver.replica(i);
+            logger::info() << "replica " << i << " (now at " << replica.temperature()
+                           << "): accepted neighbours: "
+                           << rate(replica.num_of_accepted(), replica.num_of_evaluations())
+                           << std::endl;
+        }
+    }
+
+    /** Backend searching for circuits by a @p Solver, which trains for the configured number of
+     * generations every epoch.
+     *
+     * The solver holds a thread pool and can't be moved, so it is created in place by the caller
+     * and owned here. When the backend is destroyed, the solver is reported by report_solver
+     * and report_search.
+     */
+    template <typename Solver> struct search_backend : backend {
+        search_backend(json const& config, std::unique_ptr<Solver> solver)
+            : _num_of_generations(config.at("num-of-generations"))
+            , _scores_file(config.value("scores-file", "scores.txt"))
+            , _solver(std::move(solver)) {}
+
+        ~search_backend() {
+            report_solver(*_solver);
+            report_search(*_solver, _scores_file);
+        }
+
+        void train(dataset_view a, dataset_view b) override {
+            _solver->reevaluate(a, b);
+            _solver->run(_num_of_generations);
         }
 
-        double test(dataset const& a, dataset const& b) override {
-            return _solver.reevaluate(a, b);
+        double test(dataset_view a, dataset_view b) override {
+            return _solver->reevaluate(a, b);
         }
 
+        void begin_test() override { _solver->begin_reevaluation(); }
+
+        void test_chunk(dataset_view a, dataset_view b) override {
+            _solver->reevaluate_chunk(a, b);
+        }
+
+        double end_test() override { return _solver->end_reevaluation(); }
+
     private:
+        std::uint64_t _num_of_generations;
+        std::string _scores_file;
+        std::unique_ptr<Solver> _solver;
+    };
+
+    template <typename Solver>
+    std::unique_ptr<backend> make_search_backend(json const& config,
+                                                 std::unique_ptr<Solver> solver) {
+        return std::make_unique<search_backend<Solver>>(config, std::move(solver));
+    }
+
+    template <typename Circuit>
+    std::unique_ptr<backend> create_search(unsigned tv_size,
+                                           json const& config,
+                                           default_seed_source& seed,
+                                           typename Circuit::geometry_type geometry = {}) {
         using ini = basic_initializer;
         using mut = basic_mutator;
+        using cro = layer_crossover;
         using eva = categories_evaluator<Circuit>;
 
-        fn_set _function_set;
-        std::uint64_t _num_of_generations;
-        solvers::local_search<Circuit, ini, mut, eva> _solver;
-    };
+        const std::string solver = config.at("solver");
+        const fn_set function_set(config.at("function-set"));
+
+        if (solver == "global-search") {
+            using search = solvers::local_search<Circuit, ini, mut, eva>;
+            return make_search_backend(
+                    config,
+                    std::make_unique<search>(
+                            Circuit(tv_size, geometry),
+                            ini(config.at("initializer"), function_set),
+                            mut(config.at("mutator"), function_set),
+                            eva(config.at("evaluator")),
+                            seed,
+                            config.value("neighbours-per-generation", std::size_t(1)),
+                            config.value("threads", 1u),
+                            config.value("undo-mutations", false)));
+        } else if (solver == "genetic") {
+            using search = solvers::genetic_algorithm<Circuit, ini, mut, cro, eva>;
+            return make_search_backend(
+                    config,
+                    std::make_unique<search>(
+                            Circuit(tv_size, geometry),
+                            ini(config.at("initializer"), function_set),
+                            mut(config.at("mutator"), function_set),
+                            cro(config.count("crossover") != 0 ? config.at("crossover") : json()),
+                            eva(config.at("evaluator")),
+                            seed,
+                            config.value("population-size", std::size_t(32)),
+                            config.value("offspring-per-generation", std::size_t(16)),
+                            config.value("elite", std::size_t(1)),
+                            config.value("tournament-size", std::size_t(2)),
+                            config.value("threads", 1u)));
+        } else if (solver == "islands") {
+            using search = solvers::island_model<Circuit, ini, mut, eva>;
+            return make_search_backend(
+                    config,
+                    std::make_unique<search>(
+                            Circuit(tv_size, geometry),
+                            ini(config.at("initializer"), function_set),
+                            mut(config.at("mutator"), function_set),
+                            eva(config.at("evaluator")),
+                            seed,
+                            config.value("islands", std::size_t(4)),
+                            config.value("migration-interval", std::uint64_t(10)),
+                            config.value("neighbours-per-generation", std::size_t(1)),
+                            config.value("threads", 1u),
+                            config.value("undo-mutations", false)));
+        } else if (solver == "parallel-tempering") {
+            using search = solvers::parallel_tempering<Circuit, ini, mut, eva>;
+            return make_search_backend(
+                    config,
+                    std::make_unique<search>(
+                            Circuit(tv_size, geometry),
+                            ini(config.at("initializer"), function_set),
+                            mut(config.at("mutator"), function_set),
+                            eva(config.at("evaluator")),
+                            seed,
+                            config.value("temperatures",
+                                         std::vector<double>{0.0, 0.001, 0.01, 0.1}),
+                            config.value("exchange-interval", std::uint64_t(10)),
+                            config.value("threads", 1u),
+                            config.value("undo-mutations", false)));
+        } else
+            throw std::runtime_error("no such solver named [" + solver + "] is avalable");
+    }
 
     std::unique_ptr<backend>
     create_backend(unsigned tv_size, json const& config, default_seed_source& seed) {
-        std::string solver = config.at("solver");
+        const unsigned width = config.value("width", 8u);
+        const unsigned depth = config.value("depth", 5u);
+        const unsigned outputs = config.value("outputs", 1u);
 
-        if (solver == "global-search")
-            return std::make_unique<global_search<circuit<8, 5, 1>>>(tv_size, config, seed);
-        else
-            throw std::runtime_error("no such solver named [" + solver + "] is avalable");
+#define EACIRC_GEOMETRY(x, y, out)                                                                 \
+    if (width == x && depth == y && outputs == out)                                                \
+        return create_search<circuit<x, y, out>>(tv_size, config, seed);
+
+        EACIRC_CIRCUIT_GEOMETRIES
+#undef EACIRC_GEOMETRY
+
+        logger::info() << "circuit geometry " << width << "x" << depth << "x" << outputs
+                       << " is not compiled in, it runs on circuits of a dynamic size"
+                       << std::endl;
+        return create_search<dynamic_circuit>(
+                tv_size, config, seed, runtime_geometry{width, depth, outputs});
     }
 
 } // namespace circuit
@@ -4,23 +4,80 @@
 #include "functions.h"
 #include <eacirc-core/vec.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
 namespace circuit {
 
-    template <unsigned DimX, unsigned DimY, unsigned Out> struct circuit {
+    /** Geometry of circuits known at compile time, so that all loops over nodes have constant
+     * bounds.
+     */
+    template <unsigned Width, unsigned Depth, unsigned Outputs> struct fixed_geometry {
+        static constexpr unsigned width() { return Width; }
+        static constexpr unsigned depth() { return Depth; }
+        static constexpr unsigned outputs() { return Outputs; }
+    };
+
+    /** Geometry of circuits chosen at runtime, within the capacity of the circuit type.
+     *
+     * The default one has no nodes, it stands for programs not compiled yet.
+     */
+    struct runtime_geometry {
+        runtime_geometry()
+            : runtime_geometry(0, 0, 0) {}
+
+        runtime_geometry(unsigned width, unsigned depth, unsigned outputs)
+            : _width(width)
+            , _depth(depth)
+            , _outputs(outputs) {}
+
+        unsigned width() const { return _width; }
+        unsigned depth() const { return _depth; }
+        unsigned outputs() const { return _outputs; }
+
+    private:
+        unsigned _width;
+        unsigned _depth;
+        unsigned _outputs;
+    };
+
+    /** Circuit of depth() layers of width() nodes with outputs() outputs taken from the last
+     * layer.
+     *
+     * The layout is fixed-size and trivially copyable, so copying a circuit is a plain memcpy
+     * without any allocation. Connectors of the first layer select input bytes, thus their masks
+     * are as wide as the largest supported input.
+     *
+     * DimX, DimY and Out give the capacity of the layout. By default, the circuit fills it and
+     * its geometry is a compile-time constant. With runtime_geometry, the circuit uses only the
+     * leading part of the layout given when it is constructed, see dynamic_circuit.
+     */
+    template <unsigned DimX,
+              unsigned DimY,
+              unsigned Out,
+              typename Geometry = fixed_geometry<DimX, DimY, Out>>
+    struct circuit : Geometry {
         static constexpr unsigned x = DimX;
         static constexpr unsigned y = DimY;
+        static constexpr unsigned out = Out;
+
+        using geometry_type = Geometry;
 
         using output = vec<Out>;
         using connectors_type = connectors<32>;
 
+        static_assert(DimX <= connectors_type::size, "layers are too wide for the connectors");
+        static_assert(Out <= DimX, "outputs are taken from nodes of the last layer");
+
+        // members are ordered from the widest, so that nodes are not padded in the middle
         struct node {
+            connectors_type connectors{0u};
             fn function{fn::NOP};
             std::uint8_t argument{0u};
-            connectors_type connectors{0u};
             bool used{true};
         };
 
@@ -30,8 +87,13 @@ namespace circuit {
         using iterator = typename layers::iterator;
         using const_iterator = typename layers::const_iterator;
 
-        circuit(unsigned input)
-            : _input(input), _input_used(input, true) {}
+        circuit(unsigned input, Geometry geometry = Geometry())
+            : Geometry(_checked(geometry))
+            , _input(input)
+            , _input_used(_all_inputs(input)) {
+            static_assert(std::is_trivially_copyable<circuit>::value,
+                          "circuits are copied between solutions as plain bytes");
+        }
 
         circuit(circuit&&) = default;
         circuit(circuit const&) = default;
@@ -41,19 +103,41 @@ namespace circuit {
 
         unsigned input() const { return _input; }
 
+        Geometry const& geometry() const { return *this; }
+
+        friend bool operator==(circuit const& lhs, circuit const& rhs) {
+            if (lhs._input != rhs._input || lhs._input_used != rhs._input_used ||
+                lhs.width() != rhs.width() || lhs.depth() != rhs.depth() ||
+                lhs.outputs() != rhs.outputs())
+                return false;
+            for (unsigned l = 0; l != lhs.depth(); ++l) {
+                for (unsigned i = 0; i != lhs.width(); ++i) {
+                    node const& a = lhs._layers[l][i];
+                    node const& b = rhs._layers[l][i];
+                    if (a.connectors != b.connectors || a.function != b.function ||
+                        a.argument != b.argument || a.used != b.used)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        friend bool operator!=(circuit const& lhs, circuit const& rhs) { return !(lhs == rhs); }
+
+        // layers hold the nodes of the whole capacity, only the first width() of them are used
         iterator begin() { return _layers.begin(); }
         const_iterator begin() const { return _layers.begin(); }
 
-        iterator end() { return _layers.end(); }
-        const_iterator end() const { return _layers.end(); }
+        iterator end() { return _layers.begin() + this->depth(); }
+        const_iterator end() const { return _layers.begin() + this->depth(); }
 
         layer& operator[](std::size_t const i) {
-            ASSERT(i < DimY);
+            ASSERT(i < this->depth());
             return _layers[i];
         }
 
         layer const& operator[](std::size_t const i) const {
-            ASSERT(i < DimY);
+            ASSERT(i < this->depth());
             return _layers[i];
         }
 
@@ -79,11 +163,11 @@ namespace circuit {
 
             // inside nodes
             std::size_t layer_num = 0;
-            for (auto l : _layers) {
+            for (auto l : *this) {
                 of << "{ rank=same;" << std::endl;
 
                 // last layer
-                if (layer_num + 1 == _layers.size()) {
+                if (layer_num + 1 == this->depth()) {
                     of << "node [color=brown2];" << std::endl;
                     of << "\"" << layer_num << "_0\"[label=\"";
                     of << to_string(l[0].function) << "\\n" << int(l[0].argument) << "\"];" << std::endl;
@@ -91,8 +175,8 @@ namespace circuit {
                     break;
                 }
 
-                std::size_t slot_num = 0;
-                for (auto n : l) {
+                for (std::size_t slot_num = 0; slot_num != this->width(); ++slot_num) {
+                    auto n = l[slot_num];
                     if (n.used) {
                         of << "node [color=lightblue3];" << std::endl;
                     } else {
@@ -100,7 +184,6 @@ namespace circuit {
                     }
                     of << "\"" << layer_num << "_" << slot_num << "\"[label=\"";
                     of << to_string(n.function) << "\\n" << int(n.argument) << "\"];" << std::endl;
-                    ++slot_num;
                 }
 
                 of << "}" << std::endl;
@@ -121,21 +204,18 @@ namespace circuit {
 
             // inside nodes
             layer_num = 0;
-            for (auto l : _layers) {
+            for (auto l : *this) {
                 of << "\"" << layer_num << "_0\"";
 
                 // last layer
-                if (layer_num + 1 == _layers.size()) {
+                if (layer_num + 1 == this->depth()) {
                     of << " -- \"" << layer_num << "_0\";" << std::endl;
                     break;
                 }
 
-                std::size_t slot_num = 0;
-                for (auto _ : l) {
-                    if (slot_num != 0) // first node was written manually above
-                        of << " -- \"" << layer_num << "_" << slot_num << "\"";
-                    ++slot_num;
-                }
+                // first node was written manually above
+                for (std::size_t slot_num = 1; slot_num < this->width(); ++slot_num)
+                    of << " -- \"" << layer_num << "_" << slot_num << "\"";
 
                 of << ";" << std::endl;
                 ++layer_num;
@@ -145,20 +225,18 @@ namespace circuit {
             of << "edge[style=solid];" << std::endl;
 
             layer_num = 0;
-            for (auto l : _layers) {
+            for (auto l : *this) {
 
-                std::size_t slot_num = 0;
-                for (auto n : l) {
+                for (std::size_t slot_num = 0; slot_num != this->width(); ++slot_num) {
+                    auto n = l[slot_num];
 
                     for (auto it = n.connectors.iterator(); it.has_next(); it.next()) {
                         of << "\"" << layer_num << "_" << slot_num << "\" -- \"" << (int(layer_num) - 1) << "_" << it << "\";" << std::endl;
                     }
 
                     // last layer
-                    if (layer_num + 1 == _layers.size())
+                    if (layer_num + 1 == this->depth())
                         break;
-
-                    ++slot_num;
                 }
 
                 ++layer_num;
@@ -171,18 +249,17 @@ namespace circuit {
 
         void prune() {
             // BFS - set all nodes unvisited
-            for (auto &l : _layers)
+            for (auto &l : *this)
                 for (auto &n : l)
                     n.used = false;
-            for (auto &&u : _input_used) // C++ specialization of std::vector<bool> - proxy iterator
-                u = false;
+            _input_used = 0u;
 
             // the single output node is used
-            _layers[_layers.size() - 1][0].used = true;
+            _layers[this->depth() - 1][0].used = true;
 
 
             // l_i is by 1 more, than current layer number, to hold even for input layer
-            for (std::size_t l_i = _layers.size(); l_i != 0; --l_i) {
+            for (std::size_t l_i = this->depth(); l_i != 0; --l_i) {
                 for (auto &n : _layers[l_i-1]) {
                     if (!n.used) {
                         n.connectors = 0u;
@@ -194,7 +271,7 @@ namespace circuit {
 
                     while (arity != 0 && it.has_next()) {
                         if (l_i == 1) {
-                            _input_used[it] = true;
+                            _input_used.set(it);
                         } else {
                             _layers[l_i - 2][it].used = true;
                         }
@@ -210,10 +287,74 @@ namespace circuit {
             }
         }
 
+        /** Recomputes the used flags of all nodes and of inputs.
+         *
+         * Nodes are used if any output depends on them. Unlike prune() it does not touch the
+         * connectors.
+         */
+        void update_liveness() {
+            for (std::size_t i = 0; i != DimX; ++i)
+                _layers[this->depth() - 1][i].used = i < this->outputs();
+            update_liveness(this->depth() - 1);
+        }
+
+        /** Recomputes the used flags of nodes in layers below @p layer and of inputs.
+         *
+         * Usage of a layer depends only on the layers above it, so after changing nodes in
+         * layers up to l it suffices to call update_liveness(l).
+         */
+        void update_liveness(std::size_t layer) {
+            for (std::size_t l = layer; l != 0; --l) {
+                for (auto& n : _layers[l - 1])
+                    n.used = false;
+                for (auto const& n : _layers[l])
+                    if (n.used)
+                        _mark_used(n, [this, l](unsigned i) { _layers[l - 1][i].used = true; });
+            }
+
+            _input_used = 0u;
+            for (auto const& n : _layers[0])
+                if (n.used)
+                    _mark_used(n, [this](unsigned i) { _input_used.set(i); });
+        }
+
     private:
         layers _layers;
         unsigned _input;
-        std::vector<bool> _input_used;
+        connectors_type _input_used;
+
+        static typename connectors_type::value_type _all_inputs(unsigned input) {
+            using value_type = typename connectors_type::value_type;
+            if (input > connectors_type::size)
+                throw std::runtime_error("circuits support inputs of at most " +
+                                         std::to_string(connectors_type::size) + " bytes");
+            return input == connectors_type::size ? value_type(~value_type(0))
+                                                  : value_type((value_type(1) << input) - 1);
+        }
+
+        static Geometry _checked(Geometry geometry) {
+            if (geometry.width() == 0 || geometry.width() > DimX || geometry.depth() == 0 ||
+                geometry.depth() > DimY || geometry.outputs() == 0 ||
+                geometry.outputs() > std::min(geometry.width(), Out))
+                throw std::runtime_error(
+                        "circuits of this type support at most " + std::to_string(DimX) +
+                        " nodes per layer, " + std::to_string(DimY) + " layers and " +
+                        std::to_string(Out) + " outputs, which can't outnumber the nodes");
+            return geometry;
+        }
+
+        template <typename Mark> static void _mark_used(node const& n, Mark mark) {
+            std::size_t arity = fn_arity(n.function);
+            for (auto it = n.connectors.iterator(); arity != 0 && it.has_next(); it.next(), --arity)
+                mark(it);
+        }
     };
 
+    /** Circuit of any geometry up to 32 nodes per layer and 16 layers, chosen at runtime.
+     *
+     * Its loops run over the geometry given at construction instead of constant bounds, so it
+     * serves geometries for which no circuit type is compiled.
+     */
+    using dynamic_circuit = circuit<32, 16, 32, runtime_geometry>;
+
 } // namespace circuit
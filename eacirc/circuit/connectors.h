@@ -7,7 +7,7 @@ namespace circuit {
 
     namespace _impl {
 
-        int count_trailing_zeros(std::uint64_t x) {
+        inline int count_trailing_zeros(std::uint64_t x) {
 #ifdef __GNUC__
             return __builtin_ctzll(x);
 #elif _MSC_VER
@@ -43,7 +43,7 @@ namespace circuit {
 #endif
         }
 
-        int count_trailing_zeros(std::uint32_t x) {
+        inline int count_trailing_zeros(std::uint32_t x) {
 #ifdef __GNUC__
             return __builtin_ctz(x);
 #elif _MSC_VER
@@ -75,11 +75,11 @@ namespace circuit {
 #endif
         }
 
-        int count_trailing_zeros(std::uint16_t x) {
+        inline int count_trailing_zeros(std::uint16_t x) {
             return count_trailing_zeros(static_cast<std::uint32_t>(x));
         }
 
-        int count_trailing_zeros(std::uint8_t x) {
+        inline int count_trailing_zeros(std::uint8_t x) {
             return count_trailing_zeros(static_cast<std::uint32_t>(x));
         }
 
@@ -24,7 +24,7 @@ namespace circuit {
         _Size // this must be the last item of this enum
     };
 
-    std::string to_string(fn func) {
+    inline std::string to_string(fn func) {
         switch (func) {
         case fn::NOP:
             return "NOP";
@@ -58,7 +58,7 @@ namespace circuit {
         throw std::invalid_argument("such function does not exist");
     }
 
-    fn from_string(std::string str) {
+    inline fn from_string(std::string str) {
         if (str == to_string(fn::NOP))
             return fn::NOP;
         if (str == to_string(fn::CONS))
@@ -88,7 +88,7 @@ namespace circuit {
         throw std::invalid_argument("such function does not exist");
     }
 
-    std::size_t fn_arity(fn f) {
+    inline std::size_t fn_arity(fn f) {
         switch (f) {
         case fn::CONS:
             return 0;
@@ -111,6 +111,22 @@ namespace circuit {
         }
     }
 
+    /** Whether the result of the function depends on the node argument
+     */
+    inline bool fn_has_argument(fn f) {
+        switch (f) {
+        case fn::CONS:
+        case fn::SHIL:
+        case fn::SHIR:
+        case fn::ROTL:
+        case fn::ROTR:
+        case fn::MASK:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     struct fn_set {
         fn_set(std::initializer_list<fn> samples)
             : _size(samples.size()) {
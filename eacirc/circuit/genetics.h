@@ -1,12 +1,21 @@
 #pragma once
 
+#include "../dataset_view.h"
 #include "../statistics.h"
 #include "circuit.h"
-#include "interpreter.h"
+#include "histogram.h"
+#include "mutation.h"
+#include "program.h"
 #include <algorithm>
+#include <cmath>
 #include <eacirc-core/dataset.h>
 #include <eacirc-core/json.h>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <stdexcept>
 
 namespace circuit {
 
@@ -17,7 +26,9 @@ namespace circuit {
 
     template <typename Connectors, typename Generator>
     static Connectors generate_connetors(Generator& g, unsigned size) {
-        std::uniform_int_distribution<typename Connectors::value_type> dst{0, (1u << size) - 1};
+        // a shift by the whole width of the connectors would be undefined
+        const auto all = size >= 32 ? ~0u : (1u << size) - 1;
+        std::uniform_int_distribution<typename Connectors::value_type> dst{0, all};
         return Connectors{dst(g)};
     }
 
@@ -28,18 +39,60 @@ namespace circuit {
             , _changes_of_connectors(config.at("changes-of-connectors"))
             , _function_set(std::move(function_set)) {}
 
+        template <typename Circuit> using record = mutation<Circuit>;
+
         template <typename Circuit, typename Generator> void apply(Circuit& circuit, Generator& g) {
-            std::uniform_int_distribution<std::size_t> x{0, Circuit::x - 1};
-            std::uniform_int_distribution<std::size_t> y{0, Circuit::y - 1};
+            mutation<Circuit> changes;
+            apply(circuit, g, changes);
+        }
+
+        /** Mutates the circuit and records the changed nodes into @p changes.
+         *
+         * Changes are checked against the used flags of the circuit, which are kept up to date.
+         * Changes of unused nodes, of arguments ignored by the node function and of connectors
+         * beyond the arity of the function are neutral and thus not recorded. Still, all of them
+         * get into the undo log, if the record keeps one.
+         */
+        template <typename Circuit, typename Generator>
+        void apply(Circuit& circuit, Generator& g, mutation<Circuit>& changes) {
+            std::uniform_int_distribution<std::size_t> x{0, circuit.width() - 1};
+            std::uniform_int_distribution<std::size_t> y{0, circuit.depth() - 1};
+
+            changes.clear();
+            std::size_t top = 0;
+
+            auto touch = [&](std::size_t y_idx, std::size_t x_idx) {
+                changes.touch(unsigned(y_idx), unsigned(x_idx));
+                top = std::max(top, y_idx);
+            };
+
+            // positions are drawn in the order gcc evaluated the former circuit[y(g)][x(g)]
+            // expressions, so the same seed still leads to the same circuits
 
             // mutate functions
             for (size_t i = 0; i != _changes_of_functions; ++i) {
-                circuit[y(g)][x(g)].function = _function_set.choose(g);
+                const auto x_idx = x(g);
+                const auto y_idx = y(g);
+                auto& node = circuit[y_idx][x_idx];
+                changes.save(unsigned(y_idx), unsigned(x_idx), node);
+
+                const fn function = _function_set.choose(g);
+                if (node.used && node.function != function)
+                    touch(y_idx, x_idx);
+                node.function = function;
             }
 
             // mutate arguments
             for (size_t i = 0; i != _changes_of_arguments; ++i) {
-                circuit[y(g)][x(g)].argument = generate_argument(g);
+                const auto x_idx = x(g);
+                const auto y_idx = y(g);
+                auto& node = circuit[y_idx][x_idx];
+                changes.save(unsigned(y_idx), unsigned(x_idx), node);
+
+                const std::uint8_t argument = generate_argument(g);
+                if (node.used && node.argument != argument && fn_has_argument(node.function))
+                    touch(y_idx, x_idx);
+                node.argument = argument;
             }
 
             // mutate connectors
@@ -48,14 +101,21 @@ namespace circuit {
 
                 uniform_distribution dst;
                 uniform_distribution::param_type first_layer{0, circuit.input() - 1};
-                uniform_distribution::param_type other_layer{0, Circuit::x - 1};
+                uniform_distribution::param_type other_layer{0, circuit.width() - 1};
 
                 const auto y_idx = y(g);
-                if (y_idx == 0)
-                    circuit[y_idx][x(g)].connectors.flip(dst(g, first_layer));
-                else
-                    circuit[y_idx][x(g)].connectors.flip(dst(g, other_layer));
+                const auto x_idx = x(g);
+                auto& node = circuit[y_idx][x_idx];
+                changes.save(unsigned(y_idx), unsigned(x_idx), node);
+
+                const unsigned bit = y_idx == 0 ? dst(g, first_layer) : dst(g, other_layer);
+                if (node.used && _reads_connector(node, bit))
+                    touch(y_idx, x_idx);
+                node.connectors.flip(bit);
             }
+
+            if (!changes.neutral())
+                circuit.update_liveness(top);
         }
 
     private:
@@ -63,6 +123,18 @@ namespace circuit {
         const std::size_t _changes_of_arguments;
         const std::size_t _changes_of_connectors;
         const fn_set _function_set;
+
+        // whether flipping the connector can change the output of the node
+        template <typename Node> static bool _reads_connector(Node const& node, unsigned bit) {
+            std::size_t arity = fn_arity(node.function);
+            for (auto it = node.connectors.iterator(); arity != 0 && it.has_next(); it.next()) {
+                if (unsigned(it) >= bit)
+                    return true;
+                --arity;
+            }
+            // beyond the arity only if the connectors already read by the function are before
+            return arity != 0;
+        }
     };
 
     struct basic_initializer {
@@ -71,7 +143,7 @@ namespace circuit {
 
         template <typename Circuit, typename Generator> void apply(Circuit& circuit, Generator& g) {
             // for the first layer...
-            for (unsigned i = 0; i != Circuit::x; ++i) {
+            for (unsigned i = 0; i != circuit.width(); ++i) {
                 auto& node = circuit[0][i];
 
                 node.connectors = (i < circuit.input()) ? (1u << i) : 0u;
@@ -80,46 +152,796 @@ namespace circuit {
             }
 
             // for the other layers...
-            for (unsigned i = 1; i != Circuit::y; ++i)
-                for (auto& node : circuit[i]) {
+            for (unsigned i = 1; i != circuit.depth(); ++i)
+                for (unsigned j = 0; j != circuit.width(); ++j) {
                     using connectors = typename Circuit::connectors_type;
-                    node.connectors = generate_connetors<connectors>(g, Circuit::x);
+                    auto& node = circuit[i][j];
+                    node.connectors = generate_connetors<connectors>(g, circuit.width());
                     node.function = _function_set.choose(g);
                     node.argument = generate_argument(g);
                 }
+
+            circuit.update_liveness();
         }
 
     private:
         const fn_set _function_set;
     };
 
+    /** Crossover taking every layer of the child from either of the parents at random.
+     *
+     * Nodes are connected only to the previous layer, so any mix of layers of two circuits of the
+     * same shape is a valid circuit.
+     */
+    struct layer_crossover {
+        layer_crossover(json const&) {}
+
+        template <typename Circuit, typename Generator>
+        void apply(Circuit const& a, Circuit const& b, Circuit& child, Generator& g) {
+            std::bernoulli_distribution from_b;
+            child = a;
+            for (unsigned l = 0; l != child.depth(); ++l)
+                if (from_b(g))
+                    child[l] = b[l];
+            child.update_liveness();
+        }
+    };
+
+    /** Bounded direct-mapped cache of scores keyed by program hashes
+     */
+    struct score_cache {
+        score_cache(std::size_t size)
+            : _entries(size)
+            , _hits(0)
+            , _misses(0) {}
+
+        bool enabled() const { return !_entries.empty(); }
+
+        bool find(std::uint64_t key, double& score) {
+            entry const& e = _entries[key % _entries.size()];
+            if (e.valid && e.key == key) {
+                score = e.score;
+                ++_hits;
+                return true;
+            }
+            ++_misses;
+            return false;
+        }
+
+        void insert(std::uint64_t key, double score) {
+            _entries[key % _entries.size()] = entry{key, score, true};
+        }
+
+        void clear() { std::fill(_entries.begin(), _entries.end(), entry{0u, 0.0, false}); }
+
+        std::uint64_t hits() const { return _hits; }
+        std::uint64_t misses() const { return _misses; }
+
+    private:
+        struct entry {
+            std::uint64_t key;
+            double score;
+            bool valid;
+        };
+
+        std::vector<entry> _entries;
+        std::uint64_t _hits;
+        std::uint64_t _misses;
+    };
+
+    /** Early rejection of candidates evaluated on growing prefixes of both datasets.
+     *
+     * The prefixes double from the first fraction f of the datasets up to whole datasets. The
+     * normalized differences of the histograms over whole datasets are those of the prefix
+     * scaled by 1 / sqrt(f), plus the noise of the rest of the data of variance (1 - f) / f. The
+     * statistic over whole datasets times f / (1 - f) is thus a non-central Chi^2 variable with
+     * the non-centrality of the prefix statistic divided by 1 - f. A candidate is rejected once
+     * even the statistic "confidence" standard deviations above its mean scores worse than the
+     * base.
+     */
+    struct racing {
+        racing(json const& config)
+            : _fractions{1.0}
+            , _confidence(0.0)
+            , _rejections(0)
+            , _consumed(0.0) {
+            if (config.is_null())
+                return;
+
+            double fraction = config.value("first-fraction", 0.125);
+            _confidence = config.value("confidence", 4.0);
+            if (!(fraction > 0.0 && fraction <= 1.0))
+                throw std::runtime_error("the first fraction of racing has to be in (0, 1]");
+
+            _fractions.clear();
+            for (; fraction < 1.0; fraction *= 2)
+                _fractions.emplace_back(fraction);
+            _fractions.emplace_back(1.0);
+        }
+
+        bool enabled() const { return _fractions.size() > 1; }
+
+        /** Fractions of the datasets evaluated before each decision, the last one is 1
+         */
+        std::vector<double> const& fractions() const { return _fractions; }
+
+        /** Whether the statistic of the @p fraction of the datasets rules out scoring @p score
+         */
+        bool rejects(chisqr_statistic prefix, double fraction, double score) const {
+            if (prefix.dof < 1)
+                return false;
+            const double dof = prefix.dof;
+            const double ncp = prefix.value / (1.0 - fraction);
+            const double deviation = std::sqrt(2.0 * (dof + 2.0 * ncp));
+            const double scale = (1.0 - fraction) / fraction;
+            const double bound = scale * (dof + ncp + _confidence * deviation);
+            return 1.0 - chisqr(prefix.dof, bound) < score;
+        }
+
+        void count_rejection(double fraction) {
+            ++_rejections;
+            _consumed += fraction;
+        }
+
+        std::uint64_t rejections() const { return _rejections; }
+
+        /** Average fraction of the datasets evaluated before a rejection
+         */
+        double consumed_per_rejection() const {
+            return _rejections != 0 ? _consumed / double(_rejections) : 0.0;
+        }
+
+    private:
+        std::vector<double> _fractions;
+        double _confidence;
+        std::uint64_t _rejections;
+        double _consumed;
+    };
+
+    /** Test vectors of two datasets transposed into input registers: one row of bytes per input
+     * byte, holding the vectors of the first dataset followed by those of the second one.
+     *
+     * Copies of an evaluator share the rows, so that solvers running an evaluator per thread,
+     * island or replica over the same datasets keep them in memory only once. The rows are
+     * transposed again only when an evaluator is given datasets of different contents, the old
+     * ones are freed when the last evaluator using them moves on.
+     */
+    struct transposed_datasets {
+        using rows = std::vector<std::uint8_t>;
+
+        std::shared_ptr<const rows>
+        get(dataset_view a, dataset_view b, unsigned input, std::size_t stride) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_rows && _input == input && _stride == stride && _matches(a, 0) &&
+                _matches(b, a.size()))
+                return _rows;
+
+            auto fresh = std::make_shared<rows>(input * stride, 0u);
+            transpose(a.begin(), a.size(), input, fresh->data(), stride);
+            transpose(b.begin(), b.size(), input, fresh->data() + a.size(), stride);
+            _rows = std::move(fresh);
+            _input = input;
+            _stride = stride;
+            return _rows;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::shared_ptr<const rows> _rows;
+        unsigned _input{0};
+        std::size_t _stride{0};
+
+        bool _matches(dataset_view data, std::size_t lane) const {
+            for (auto vec : data) {
+                std::size_t i = 0;
+                for (std::uint8_t byte : vec)
+                    if ((*_rows)[i++ * _stride + lane] != byte)
+                        return false;
+                ++lane;
+            }
+            return true;
+        }
+    };
+
+    /** Scores circuits by the two-sample Chi^2 test of their outputs over two datasets.
+     *
+     * Circuits are compiled and run over the datasets batch by batch. Unless the datasets are
+     * too large, they are stored transposed, one column of bytes per input byte, shared by all
+     * copies of the evaluator. Each of them keeps its own outputs of all nodes of the last fully
+     * evaluated circuit for every test vector. A mutated
+     * circuit is then evaluated by recomputing only the nodes affected by the mutation and by
+     * updating the histograms of the outputs which have changed. Large datasets are not copied
+     * at all, they are only referenced and transposed batch by batch during the evaluation.
+     * Output bytes are counted as soon as a batch is computed, no output vectors are stored.
+     *
+     * Optionally, scores are memoized by hashes of the compiled circuits until the datasets
+     * change, so that a circuit computing the same as one evaluated before is not run again.
+     *
+     * With "compare-statistics", an incrementally evaluated circuit whose Chi^2 statistic is
+     * clearly lower than the one of the base with the same degrees of freedom is known to score
+     * worse than the base. Its p-value is not computed then and it scores rejected instead.
+     *
+     * With "racing", mutated circuits are evaluated on growing prefixes of the datasets and
+     * score rejected as soon as they most likely score worse than the base. A rejected circuit
+     * is evaluated on the rest of the datasets only if it gets accepted anyway, so the scores of
+     * accepted circuits are always exact.
+     */
     template <typename Circuit> struct categories_evaluator {
+        /** Score of circuits known to be worse than the base without computing their p-value
+         */
+        static constexpr double rejected = -std::numeric_limits<double>::infinity();
+
         categories_evaluator(json const& config)
-            : _chisqr(std::size_t(config.at("num-of-categories"))) {}
+            : _chisqr(std::size_t(config.at("num-of-categories")))
+            , _cache(config.value("cache-size", std::size_t(0)))
+            , _compare_statistics(config.value("compare-statistics", false))
+            , _racing(config.count("racing") != 0 ? config.at("racing") : json())
+            , _input(0)
+            , _num_of_a(0)
+            , _num_of_b(0)
+            , _stride(0)
+            , _cached(false)
+            , _base_valid(false)
+            , _pending(false)
+            , _deferred(false)
+            , _prefixes_valid(false)
+            , _transposed(std::make_shared<transposed_datasets>())
+            , _stage(0)
+            , _executed_a(0)
+            , _executed_b(0) {}
 
-        void change_datasets(dataset const& a, dataset const& b) {
+        /** Sets the datasets to evaluate circuits on, they have to outlive the evaluation
+         */
+        void change_datasets(dataset_view a, dataset_view b) {
             _a = a;
             _b = b;
+            _num_of_a = a.size();
+            _num_of_b = b.size();
+            _input = _num_of_a != 0 ? unsigned((*a.begin()).size()) : 0u;
+            _stride = (_num_of_a + _num_of_b + lanes - 1) / lanes * lanes;
+            _cached = _num_of_a + _num_of_b <= max_cached_vectors;
+            _base_valid = false;
+            _pending = false;
+            _deferred = false;
+            _prefixes_valid = false;
+            if (_cache.enabled())
+                _cache.clear();
+
+            _stages_a.assign(1, 0u);
+            _stages_b.assign(1, 0u);
+            for (double fraction : _racing.fractions()) {
+                _stages_a.emplace_back(_prefix_size(fraction, _num_of_a));
+                _stages_b.emplace_back(_prefix_size(fraction, _num_of_b));
+            }
+
+            if (!_cached) {
+                _inputs.reset();
+                _registers.clear();
+                _registers.shrink_to_fit();
+                return;
+            }
+
+            _inputs = _transposed->get(a, b, _input, _stride);
+            // sized by the first evaluated program, which gives the number of nodes
+            _registers.clear();
         }
 
+        /** Evaluates the circuit from scratch, it becomes the base of incremental evaluation
+         */
         double apply(Circuit const& circuit) {
-            interpreter<Circuit> kernel{circuit};
+            _base.prog.compile(circuit);
+            _base.score = _evaluate(_base);
+            _base_valid = _cached;
+            _pending = false;
+            _deferred = false;
+            _prefixes_valid = false;
+            if (_cache.enabled())
+                _cache.insert(_base.prog.hash(), _base.score);
+            return _base.score;
+        }
+
+        /** Evaluates the circuit which differs from the base only by the mutation @p changes
+         *
+         * It may score rejected if statistics are compared or racing is enabled and it is worse
+         * than the base.
+         */
+        double apply(Circuit const& circuit, mutation<Circuit> const& changes) {
+            std::uint64_t key = 0;
+            double score = 0.0;
+
+            if (_cache.enabled()) {
+                _key.compile(circuit);
+                key = _key.hash();
+                if (_cache.find(key, score)) {
+                    // the columns are computed only if the circuit gets accepted
+                    if (_base_valid || !_cached) {
+                        if (_base_valid)
+                            _candidate.prog.compile(circuit, changes, _base.prog);
+                        _candidate.score = score;
+                        _pending = true;
+                        _deferred = true;
+                    }
+                    return score;
+                }
+            }
+
+            if (_base_valid) {
+                _candidate.prog.compile(circuit, changes, _base.prog);
+                score = _evaluate_changes(true);
+                _pending = true;
+                _deferred = false;
+            } else if (!_cached) {
+                _candidate.prog.compile(circuit);
+                score = _evaluate_candidate(true);
+                _pending = true;
+                _deferred = false;
+            } else {
+                _candidate.prog.compile(circuit);
+                score = _evaluate(_candidate);
+            }
+
+            if (_cache.enabled() && score != rejected)
+                _cache.insert(key, score);
+            return score;
+        }
+
+        /** Makes the last incrementally evaluated circuit the new base
+         */
+        void accept() {
+            if (!_pending)
+                return;
+            if (_deferred && _base_valid)
+                _evaluate_changes(false);
+            else if (!_deferred && _candidate.score == rejected && _base_valid)
+                _continue_changes(false);
+            else if (!_deferred && _candidate.score == rejected)
+                _continue_candidate(false);
+            if (_candidate.score == rejected)
+                _candidate.score = 1.0 - _candidate.statistic.pvalue();
+
+            _pending = false;
+            _deferred = false;
+            if (!_base_valid) {
+                // only the score of the base is used, as the threshold of racing
+                _base.statistic = _candidate.statistic;
+                _base.score = _candidate.score;
+                return;
+            }
+
+            auto const& geometry = _candidate.prog.geometry();
+            for (unsigned l = 0; l != geometry.depth(); ++l) {
+                for (unsigned i = 0; i != geometry.width(); ++i) {
+                    const auto scratch = _candidate.prog.scratch_register(l, i);
+                    if (_candidate.prog.value(l, i) == scratch)
+                        simd::copy(_node_column(_candidate.prog.node_register(l, i)),
+                                   _column(scratch),
+                                   _stride);
+                }
+            }
+            _candidate.prog.retarget();
+
+            std::swap(_base, _candidate);
+            _prefixes_valid = false;
+        }
+
+        /** Evaluates the circuits from @p first to @p last from scratch, writing their scores
+         * to @p scores.
+         *
+         * The datasets are read only once for all of the circuits: they run one after another
+         * over a tile of test vectors small enough to stay in L1 cache, before the next tile is
+         * loaded. The scores equal those of apply(circuit), but the base is left unchanged.
+         */
+        template <typename Iterator, typename OutputIterator>
+        OutputIterator apply(Iterator first, Iterator last, OutputIterator scores) {
+            _population.resize(std::size_t(std::distance(first, last)));
+            for (auto& m : _population) {
+                m.prog.compile(*first++);
+                m.known = _cache.enabled() && _cache.find(m.prog.hash(), m.score);
+                m.counts_a.clear();
+                m.counts_b.clear();
+            }
+
+            _evaluate_tiles(_a, 0, false);
+            _evaluate_tiles(_b, _num_of_a, true);
+
+            for (auto& m : _population) {
+                if (!m.known) {
+                    _scored.histogram_a.assign(_chisqr.categories(), 0u);
+                    _scored.histogram_b.assign(_chisqr.categories(), 0u);
+                    m.counts_a.fold(_scored.histogram_a);
+                    m.counts_b.fold(_scored.histogram_b);
+                    m.score = _score(_scored);
+                    if (_cache.enabled())
+                        _cache.insert(m.prog.hash(), m.score);
+                }
+                *scores++ = m.score;
+            }
+            return scores;
+        }
 
-            _oa.clear();
-            _ob.clear();
+        /** Starts evaluation of the circuit over datasets given chunk by chunk.
+         *
+         * Chunks are evaluated as they come and only the histograms are kept, so datasets of any
+         * size can be streamed through the evaluator. It does not affect the base circuit.
+         */
+        void begin_chunks(Circuit const& circuit) {
+            _chunked.prog.compile(circuit);
+            _chunked.histogram_a.assign(_chisqr.categories(), 0u);
+            _chunked.histogram_b.assign(_chisqr.categories(), 0u);
+            _counts_a.clear();
+            _counts_b.clear();
+        }
 
-            std::transform(_a.begin(), _a.end(), std::back_inserter(_oa), kernel);
-            std::transform(_b.begin(), _b.end(), std::back_inserter(_ob), kernel);
+        void add_chunks(dataset_view a, dataset_view b) {
+            _evaluate_batches(_chunked.prog, a, _counts_a);
+            _evaluate_batches(_chunked.prog, b, _counts_b);
+        }
 
-            return 1.0 - _chisqr(_oa, _ob);
+        /** Score of the circuit over all the chunks, the same as if given at once
+         */
+        double finish_chunks() {
+            _counts_a.fold(_chunked.histogram_a);
+            _counts_b.fold(_chunked.histogram_b);
+            _chunked.score = _score(_chunked);
+            return _chunked.score;
         }
 
+        score_cache const& cache() const { return _cache; }
+
+        racing const& race() const { return _racing; }
+
+        /** Whether every circuit is scored exactly, i.e. none scores rejected
+         */
+        bool scores_exactly() const { return !_compare_statistics && !_racing.enabled(); }
+
     private:
-        dataset _a;
-        dataset _b;
-        std::vector<typename Circuit::output> _oa;
-        std::vector<typename Circuit::output> _ob;
+        using histogram = byte_counts::histogram;
+
+        static constexpr unsigned lanes = 64;
+
+        // keeping outputs of all nodes costs two bytes per node and test vector
+        static constexpr std::size_t max_cached_vectors = std::size_t(1) << 16;
+
+        // test vectors evaluated by all circuits of a population before the next ones
+        static constexpr std::size_t tile = 4 * lanes;
+
+        // statistics are compared only where they cannot score the same after rounding
+        static constexpr double min_compared_pvalue = 1e-6;
+        static constexpr double statistic_margin = 1e-9;
+
+        struct state {
+            program<Circuit> prog;
+            histogram histogram_a;
+            histogram histogram_b;
+            chisqr_statistic statistic;
+            double score{0.0};
+        };
+
+        struct member {
+            program<Circuit> prog;
+            byte_counts counts_a;
+            byte_counts counts_b;
+            double score{0.0};
+            bool known{false};
+        };
+
         two_sample_chisqr _chisqr;
+        score_cache _cache;
+        bool _compare_statistics;
+        racing _racing;
+
+        unsigned _input;
+        std::size_t _num_of_a;
+        std::size_t _num_of_b;
+        std::size_t _stride;
+        bool _cached;
+        bool _base_valid;
+        bool _pending;
+        bool _deferred;
+        bool _prefixes_valid;
+
+        dataset_view _a;
+        dataset_view _b;
+        std::shared_ptr<transposed_datasets> _transposed;
+        std::shared_ptr<const transposed_datasets::rows> _inputs;
+        std::vector<std::uint8_t> _registers; // outputs of the nodes, then the scratch ones
+        std::vector<std::uint8_t> _block;
+        byte_counts _counts_a;
+        byte_counts _counts_b;
+        state _base;
+        state _candidate;
+        state _chunked;
+        state _scored;
+        program<Circuit> _key;
+        std::vector<member> _population;
+        std::vector<std::uint8_t> _tile;
+
+        // test vectors of each dataset evaluated before the stages of racing, starting with 0
+        std::vector<std::size_t> _stages_a;
+        std::vector<std::size_t> _stages_b;
+        // histograms of the base over the prefixes of the stages but the last one
+        std::vector<histogram> _prefixes_a;
+        std::vector<histogram> _prefixes_b;
+        histogram _raced_a;
+        histogram _raced_b;
+        // the candidate has been evaluated up to this stage and on these blocks of lanes
+        std::size_t _stage;
+        std::size_t _executed_a;
+        std::size_t _executed_b;
+
+        std::uint8_t const* _column(std::size_t reg) const {
+            return reg < _input ? _inputs->data() + reg * _stride : _node_column(reg);
+        }
+
+        std::uint8_t* _node_column(std::size_t reg) {
+            return _registers.data() + (reg - _input) * _stride;
+        }
+
+        std::uint8_t const* _node_column(std::size_t reg) const {
+            return _registers.data() + (reg - _input) * _stride;
+        }
+
+        double _score(state& s) const {
+            s.statistic = two_sample_chisqr::statistic(s.histogram_a, s.histogram_b);
+            return 1.0 - s.statistic.pvalue();
+        }
+
+        static std::size_t _prefix_size(double fraction, std::size_t size) {
+            return fraction < 1.0 ? std::min(size, std::size_t(std::ceil(fraction * size))) : size;
+        }
+
+        std::size_t _num_of_stages() const { return _stages_a.size() - 1; }
+
+        // runs the incrementally compiled candidate and updates the histograms of the base
+        double _evaluate_changes(bool race) {
+            race = race && _racing.enabled();
+            if (race && !_prefixes_valid)
+                _count_prefixes();
+
+            _counts_a.clear();
+            _counts_b.clear();
+            _executed_a = 0;
+            _executed_b = _num_of_a / lanes;
+            _stage = 0;
+
+            bool changed = false;
+            for (unsigned i = 0; i != _base.prog.num_of_outputs(); ++i)
+                changed |= _base.prog.output_register(i) != _candidate.prog.output_register(i);
+
+            if (!changed) {
+                // the nodes are still computed, they are needed if the candidate gets accepted
+                _execute(_num_of_a, _num_of_b);
+                _stage = _num_of_stages();
+                _candidate.histogram_a = _base.histogram_a;
+                _candidate.histogram_b = _base.histogram_b;
+                _candidate.statistic = _base.statistic;
+                _candidate.score = _base.score;
+                return _candidate.score;
+            }
+            return _continue_changes(race);
+        }
+
+        // evaluates the remaining stages of the candidate, unless it gets rejected after one
+        double _continue_changes(bool race) {
+            while (_stage != _num_of_stages()) {
+                const std::size_t first_a = _stages_a[_stage];
+                const std::size_t first_b = _num_of_a + _stages_b[_stage];
+                ++_stage;
+                const std::size_t size_a = _stages_a[_stage] - _stages_a[_stage - 1];
+                const std::size_t size_b = _stages_b[_stage] - _stages_b[_stage - 1];
+                _execute(_stages_a[_stage], _stages_b[_stage]);
+
+                for (unsigned i = 0; i != _base.prog.num_of_outputs(); ++i) {
+                    const auto from = _base.prog.output_register(i);
+                    const auto to = _candidate.prog.output_register(i);
+                    if (from != to) {
+                        _counts_a.move(_column(from) + first_a, _column(to) + first_a, size_a);
+                        _counts_b.move(_column(from) + first_b, _column(to) + first_b, size_b);
+                    }
+                }
+
+                if (race && _stage != _num_of_stages()) {
+                    _raced_a = _prefixes_a[_stage - 1];
+                    _raced_b = _prefixes_b[_stage - 1];
+                    if (_rejects())
+                        return _candidate.score;
+                }
+            }
+
+            _candidate.histogram_a = _base.histogram_a;
+            _candidate.histogram_b = _base.histogram_b;
+            _counts_a.fold(_candidate.histogram_a);
+            _counts_b.fold(_candidate.histogram_b);
+
+            if (_compare_statistics && _base.score < 1.0 - min_compared_pvalue) {
+                // a statistic lower by the margin gives a p-value larger by more than rounding
+                auto const& base = _base.statistic;
+                auto& statistic = _candidate.statistic;
+                statistic = two_sample_chisqr::statistic(_candidate.histogram_a,
+                                                         _candidate.histogram_b);
+                if (statistic.dof == base.dof &&
+                    statistic.value < base.value * (1.0 - statistic_margin)) {
+                    _candidate.score = rejected;
+                    return _candidate.score;
+                }
+                _candidate.score = 1.0 - statistic.pvalue();
+                return _candidate.score;
+            }
+            _candidate.score = _score(_candidate);
+            return _candidate.score;
+        }
+
+        // runs the candidate on all blocks of lanes with the first @p end_a test vectors of a and
+        // the first @p end_b ones of b, a block may hold vectors of both datasets
+        void _execute(std::size_t end_a, std::size_t end_b) {
+            const std::size_t first_b = _num_of_a / lanes;
+            for (const std::size_t last = (end_a + lanes - 1) / lanes; _executed_a < last;
+                 ++_executed_a) {
+                if (_executed_a < first_b || _executed_a >= _executed_b)
+                    _execute_lanes(_candidate.prog, _executed_a * lanes);
+            }
+            for (const std::size_t last = (_num_of_a + end_b + lanes - 1) / lanes;
+                 _executed_b < last;
+                 ++_executed_b) {
+                if (_executed_b >= _executed_a)
+                    _execute_lanes(_candidate.prog, _executed_b * lanes);
+            }
+        }
+
+        // histograms of outputs of the base over the prefixes of the datasets
+        void _count_prefixes() {
+            _counts_a.clear();
+            _counts_b.clear();
+            _prefixes_a.resize(_num_of_stages() - 1);
+            _prefixes_b.resize(_num_of_stages() - 1);
+
+            for (std::size_t stage = 1; stage != _num_of_stages(); ++stage) {
+                const std::size_t first_a = _stages_a[stage - 1];
+                const std::size_t first_b = _num_of_a + _stages_b[stage - 1];
+                for (auto reg : _base.prog.outputs()) {
+                    _counts_a.add(_column(reg) + first_a, _stages_a[stage] - _stages_a[stage - 1]);
+                    _counts_b.add(_column(reg) + first_b, _stages_b[stage] - _stages_b[stage - 1]);
+                }
+                _prefixes_a[stage - 1].assign(_chisqr.categories(), 0u);
+                _prefixes_b[stage - 1].assign(_chisqr.categories(), 0u);
+                _counts_a.fold(_prefixes_a[stage - 1]);
+                _counts_b.fold(_prefixes_b[stage - 1]);
+            }
+            _prefixes_valid = true;
+        }
+
+        // evaluates the candidate from scratch stage by stage, when the datasets are not cached
+        double _evaluate_candidate(bool race) {
+            _counts_a.clear();
+            _counts_b.clear();
+            _stage = 0;
+            return _continue_candidate(race && _racing.enabled());
+        }
+
+        double _continue_candidate(bool race) {
+            while (_stage != _num_of_stages()) {
+                const std::size_t first_a = _stages_a[_stage];
+                const std::size_t first_b = _stages_b[_stage];
+                ++_stage;
+                _evaluate_batches(_candidate.prog,
+                                  _a.subview(first_a, _stages_a[_stage] - first_a),
+                                  _counts_a);
+                _evaluate_batches(_candidate.prog,
+                                  _b.subview(first_b, _stages_b[_stage] - first_b),
+                                  _counts_b);
+
+                if (race && _stage != _num_of_stages()) {
+                    _raced_a.assign(_chisqr.categories(), 0u);
+                    _raced_b.assign(_chisqr.categories(), 0u);
+                    if (_rejects())
+                        return _candidate.score;
+                }
+            }
+
+            _candidate.histogram_a.assign(_chisqr.categories(), 0u);
+            _candidate.histogram_b.assign(_chisqr.categories(), 0u);
+            _counts_a.fold(_candidate.histogram_a);
+            _counts_b.fold(_candidate.histogram_b);
+            _candidate.score = _score(_candidate);
+            return _candidate.score;
+        }
+
+        // adds the counts of the candidate to the raced histograms and decides on them
+        bool _rejects() {
+            _counts_a.fold(_raced_a);
+            _counts_b.fold(_raced_b);
+            const double fraction = _racing.fractions()[_stage - 1];
+            const auto statistic = two_sample_chisqr::statistic(_raced_a, _raced_b);
+            if (!_racing.rejects(statistic, fraction, _base.score))
+                return false;
+            _racing.count_rejection(fraction);
+            _candidate.score = rejected;
+            return true;
+        }
+
+        double _evaluate(state& s) {
+            _counts_a.clear();
+            _counts_b.clear();
+
+            if (_cached) {
+                _registers.resize(2 * s.prog.num_of_nodes() * _stride);
+                for (std::size_t off = 0; off != _stride; off += lanes) {
+                    _execute_lanes(s.prog, off);
+                    for (auto reg : s.prog.outputs())
+                        _count(_column(reg) + off, off);
+                }
+            } else {
+                _evaluate_batches(s.prog, _a, _counts_a);
+                _evaluate_batches(s.prog, _b, _counts_b);
+            }
+
+            s.histogram_a.assign(_chisqr.categories(), 0u);
+            s.histogram_b.assign(_chisqr.categories(), 0u);
+            _counts_a.fold(s.histogram_a);
+            _counts_b.fold(s.histogram_b);
+            return _score(s);
+        }
+
+        // runs the program over the block of cached lanes starting with the one at @p first
+        void _execute_lanes(program<Circuit> const& prog, std::size_t first) {
+            prog.execute(_inputs->data() + first, _registers.data() + first, _stride, lanes);
+        }
+
+        // runs the program over the referenced dataset, transposing it batch by batch
+        void _evaluate_batches(program<Circuit> const& prog, dataset_view data, byte_counts& c) {
+            _block.resize(prog.num_of_registers() * lanes);
+
+            auto it = data.begin();
+            for (std::size_t left = data.size(); left != 0;) {
+                const std::size_t n = std::min<std::size_t>(left, lanes);
+                it = transpose(it, n, prog.input(), _block.data(), lanes);
+
+                prog.execute(_block.data(), lanes, lanes);
+                for (auto reg : prog.outputs())
+                    c.add(_block.data() + reg * lanes, n);
+                left -= n;
+            }
+        }
+
+        // runs the population over the dataset tile by tile, the dataset starts with the test
+        // vector at index @p offset of the cached ones
+        void _evaluate_tiles(dataset_view data, std::size_t offset, bool second) {
+            unsigned registers = 0;
+            for (auto const& m : _population)
+                registers = std::max(registers, m.prog.num_of_registers());
+            _tile.resize(registers * tile);
+
+            auto it = data.begin();
+            for (std::size_t done = 0; done != data.size();) {
+                const std::size_t n = std::min(tile, data.size() - done);
+                if (_cached) {
+                    for (unsigned i = 0; i != _input; ++i)
+                        std::copy_n(_column(i) + offset + done, n, _tile.data() + i * tile);
+                } else {
+                    it = transpose(it, n, _input, _tile.data(), tile);
+                }
+
+                for (auto& m : _population) {
+                    if (m.known)
+                        continue;
+                    m.prog.execute(_tile.data(), tile, n);
+                    for (auto reg : m.prog.outputs())
+                        (second ? m.counts_b : m.counts_a).add(_tile.data() + reg * tile, n);
+                }
+                done += n;
+            }
+        }
+
+        // counts a batch of output bytes starting with the test vector at index @p first
+        void _count(std::uint8_t const* bytes, std::size_t first) {
+            const std::size_t end = std::min(first + lanes, _num_of_a + _num_of_b);
+            const std::size_t split = std::max(first, std::min(_num_of_a, end));
+            _counts_a.add(bytes, split - first);
+            _counts_b.add(bytes + (split - first), end - split);
+        }
     };
 
+    template <typename Circuit> constexpr double categories_evaluator<Circuit>::rejected;
+    template <typename Circuit> constexpr std::size_t categories_evaluator<Circuit>::tile;
+
 } // namespace circuit
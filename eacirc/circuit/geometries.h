@@ -0,0 +1,13 @@
+#pragma once
+
+/** Geometries of circuits compiled into the circuit backend.
+ *
+ * The list holds EACIRC_GEOMETRY(width, depth, outputs) entries, each of them is instantiated
+ * with its own fully specialized code. The build sets it from the EACIRC_CIRCUIT_GEOMETRIES
+ * CMake variable, the default matches the one of CMake: the classic circuit of 8 x 5 nodes with
+ * one output and a wider one of 16 x 6 nodes with two outputs. Other geometries fall back to
+ * dynamic_circuit, whose geometry is given at runtime.
+ */
+#ifndef EACIRC_CIRCUIT_GEOMETRIES
+#define EACIRC_CIRCUIT_GEOMETRIES EACIRC_GEOMETRY(8, 5, 1) EACIRC_GEOMETRY(16, 6, 2)
+#endif
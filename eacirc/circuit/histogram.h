@@ -0,0 +1,137 @@
+#pragma once
+
+#include "simd.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace circuit {
+
+    /** Counts of output bytes, folded into Chi^2 categories only once per evaluation.
+     *
+     * Bytes are counted by their raw value, so no division (or masking) is done per byte.
+     * Consecutive bytes go to different banks, which breaks the store-to-load dependency
+     * between increments of the same counter when neighbouring outputs are equal, as they are
+     * for a skewed output distribution. The counters wrap around, so removing a byte which was
+     * counted elsewhere yields correct totals.
+     *
+     * The banks hold narrow counters to keep them small in cache. They are flushed to wide
+     * totals before the change of any counter since the last flush could exceed 31 bits.
+     */
+    struct byte_counts {
+        using histogram = std::vector<std::uint64_t>;
+
+        static constexpr unsigned banks = 4;
+
+        byte_counts()
+            : _banks{}
+            , _totals{}
+            , _unflushed(0) {}
+
+        void clear() {
+            for (auto& bank : _banks)
+                bank.fill(0u);
+            _totals.fill(0u);
+            _unflushed = 0;
+        }
+
+        void add(std::uint8_t const* bytes, std::size_t n) {
+            for (std::size_t done = 0; done != n;) {
+                const std::size_t size = _reserve(n - done);
+                _add(bytes + done, size);
+                done += size;
+            }
+        }
+
+        /** Moves each byte from its value in @p from to its value in @p to
+         *
+         * Blocks of equal bytes are skipped, other bytes are moved even if unchanged, which is
+         * cheaper than a mispredicted branch.
+         */
+        void move(std::uint8_t const* from, std::uint8_t const* to, std::size_t n) {
+            for (std::size_t done = 0; done != n;) {
+                const std::size_t size = _reserve(n - done);
+                _move(from + done, to + done, size);
+                done += size;
+            }
+        }
+
+        /** Adds the counts to the histogram, value v goes to category v % h.size()
+         */
+        void fold(histogram& h) const {
+            const std::size_t size = h.size();
+            const bool pow2 = (size & (size - 1)) == 0;
+            for (unsigned v = 0; v != 256; ++v) {
+                std::uint64_t count = _totals[v];
+                for (auto const& bank : _banks)
+                    count += _widen(bank[v]);
+                h[pow2 ? v & (size - 1) : v % size] += count;
+            }
+        }
+
+    private:
+        using counter = std::uint32_t;
+
+        // no counter of a bank changes by more than this between flushes
+        static constexpr std::size_t max_unflushed = (std::size_t(1) << 31) - 1;
+
+        std::array<std::array<counter, 256>, banks> _banks;
+        std::array<std::uint64_t, 256> _totals;
+        std::size_t _unflushed;
+
+        // counters hold differences, which may be negative after moves
+        static std::uint64_t _widen(counter c) {
+            return std::uint64_t(std::int64_t(std::int32_t(c)));
+        }
+
+        // returns how many of @p n bytes can be counted before the next flush
+        std::size_t _reserve(std::size_t n) {
+            if (_unflushed == max_unflushed)
+                _flush();
+            n = std::min(n, max_unflushed - _unflushed);
+            _unflushed += n;
+            return n;
+        }
+
+        void _flush() {
+            for (auto& bank : _banks) {
+                for (unsigned v = 0; v != 256; ++v)
+                    _totals[v] += _widen(bank[v]);
+                bank.fill(0u);
+            }
+            _unflushed = 0;
+        }
+
+        void _add(std::uint8_t const* bytes, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + banks <= n; i += banks) {
+                _banks[0][bytes[i + 0]]++;
+                _banks[1][bytes[i + 1]]++;
+                _banks[2][bytes[i + 2]]++;
+                _banks[3][bytes[i + 3]]++;
+            }
+            for (; i != n; ++i)
+                _banks[0][bytes[i]]++;
+        }
+
+        void _move(std::uint8_t const* from, std::uint8_t const* to, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + simd::width <= n; i += simd::width) {
+                if (simd::equal(simd::load(from + i), simd::load(to + i)))
+                    continue;
+                for (std::size_t j = i; j != i + simd::width; j += 2) {
+                    _banks[0][from[j + 0]]--;
+                    _banks[1][to[j + 0]]++;
+                    _banks[2][from[j + 1]]--;
+                    _banks[3][to[j + 1]]++;
+                }
+            }
+            for (; i != n; ++i) {
+                _banks[0][from[i]]--;
+                _banks[1][to[i]]++;
+            }
+        }
+    };
+
+} // namespace circuit
@@ -18,9 +18,8 @@ namespace circuit {
             std::copy(in.begin(), in.end(), _in.begin());
 
             for (auto const& layer : _circuit) {
-                auto o = _out.begin();
-                for (auto const& node : layer)
-                    *o++ = execute(node);
+                for (unsigned i = 0; i != _circuit.width(); ++i)
+                    _out[i] = execute(layer[i]);
                 std::swap(_in, _out); // note this swap, so final output is in _in
             }
 
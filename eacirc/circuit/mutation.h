@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <eacirc-core/debug.h>
+#include <vector>
+
+namespace circuit {
+
+    /** Record of the nodes changed by a mutation.
+     *
+     * Filled in by the mutator, it lets the evaluator recompute only the nodes affected by the
+     * mutation instead of the whole circuit. Changes which cannot affect the outputs, e.g. of
+     * unused nodes, are not recorded, so a neutral mutation leaves the record empty.
+     *
+     * Optionally, the record keeps an undo log of the former values of all the mutated nodes,
+     * so that the mutation can be rolled back instead of mutating a copy of the circuit.
+     */
+    template <typename Circuit> struct mutation {
+        using node = typename Circuit::node;
+
+        mutation()
+            : _touched{}
+            , _neutral(true)
+            , _top(0)
+            , _undo(false) {}
+
+        void keep_undo_log(bool undo) {
+            _undo = undo;
+            _log.clear();
+        }
+
+        bool keeps_undo_log() const { return _undo; }
+
+        void clear() {
+            for (auto& layer : _touched)
+                layer.fill(false);
+            _neutral = true;
+            _top = 0;
+            _log.clear();
+        }
+
+        /** Saves the value of the node before it gets changed, if the undo log is kept
+         */
+        void save(unsigned layer, unsigned slot, node const& old) {
+            ASSERT(layer < Circuit::y && slot < Circuit::x);
+            if (_undo)
+                _log.push_back({std::uint8_t(layer), std::uint8_t(slot), old});
+        }
+
+        void touch(unsigned layer, unsigned slot) {
+            ASSERT(layer < Circuit::y && slot < Circuit::x);
+            _touched[layer][slot] = true;
+            _neutral = false;
+            _top = std::max(_top, layer);
+        }
+
+        /** Restores the circuit to its state before the mutation, including the used flags
+         */
+        void rollback(Circuit& circuit) {
+            ASSERT(_undo);
+            for (auto it = _log.rbegin(); it != _log.rend(); ++it)
+                circuit[it->layer][it->slot] = it->old;
+            // the used flags depend only on the restored nodes in layers up to the top one
+            if (!_neutral)
+                circuit.update_liveness(_top);
+            clear();
+        }
+
+        /** Whether the mutated circuit computes exactly the same outputs as before
+         */
+        bool neutral() const { return _neutral; }
+
+        bool touched(unsigned layer, unsigned slot) const {
+            ASSERT(layer < Circuit::y && slot < Circuit::x);
+            return _touched[layer][slot];
+        }
+
+    private:
+        struct entry {
+            std::uint8_t layer;
+            std::uint8_t slot;
+            node old;
+        };
+
+        std::array<std::array<bool, Circuit::x>, Circuit::y> _touched;
+        bool _neutral;
+        unsigned _top;
+        bool _undo;
+        std::vector<entry> _log;
+    };
+
+} // namespace circuit
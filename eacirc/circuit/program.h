@@ -0,0 +1,484 @@
+#pragma once
+
+#include "circuit.h"
+#include "mutation.h"
+#include "simd.h"
+#include <array>
+#include <eacirc-core/debug.h>
+#include <eacirc-core/view.h>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace circuit {
+
+    /** Operations of the compiled circuit.
+     *
+     * Unlike circuit functions, every operation has at most two sources, so variadic nodes are
+     * compiled into chains of binary operations and their negated variants are applied only in
+     * the last link of the chain.
+     */
+    enum class op : std::uint8_t { CONST, AND, NAND, OR, NOR, XOR, NOT, SHL, SHR, ROTL, MASK };
+
+    inline std::string to_string(op code) {
+        switch (code) {
+        case op::CONST:
+            return "CONST";
+        case op::AND:
+            return "AND";
+        case op::NAND:
+            return "NAND";
+        case op::OR:
+            return "OR";
+        case op::NOR:
+            return "NOR";
+        case op::XOR:
+            return "XOR";
+        case op::NOT:
+            return "NOT";
+        case op::SHL:
+            return "SHL";
+        case op::SHR:
+            return "SHR";
+        case op::ROTL:
+            return "ROTL";
+        case op::MASK:
+            return "MASK";
+        }
+        throw std::invalid_argument("such operation does not exist");
+    }
+
+    struct instruction {
+        op code;
+        std::uint8_t argument;
+        std::uint16_t dst;
+        std::uint16_t a;
+        std::uint16_t b;
+    };
+
+    /** Linear program computing the outputs of a circuit.
+     *
+     * Registers [0, input) hold the input bytes, register input + l * width + i holds the output
+     * of node i in layer l. Only live nodes are compiled, connectors are resolved to registers and
+     * nodes which merely copy their input (e.g. NOP or ROTL by 0) are aliased to their source
+     * instead of being computed.
+     */
+    template <typename Circuit> struct program {
+        using output = typename Circuit::output;
+        using geometry_type = typename Circuit::geometry_type;
+        using register_type = std::uint16_t;
+        using outputs_type = std::array<register_type, Circuit::out>;
+
+        static constexpr register_type none = 0xffff;
+
+        program()
+            : _input(0)
+            , _values{}
+            , _outputs{} {}
+
+        void compile(Circuit const& circuit) { _compile(circuit, nullptr, nullptr); }
+
+        /** Compiles only the nodes which differ from the @p base program of the circuit before
+         * the mutation @p changes: the touched nodes, nodes dead in the base and all nodes
+         * reading any of them. Their results go to scratch registers, the values of the other
+         * nodes are taken from the base registers, so the base register file stays intact.
+         */
+        void
+        compile(Circuit const& circuit, mutation<Circuit> const& changes, program const& base) {
+            ASSERT(base._input == circuit.input());
+            _compile(circuit, &changes, &base);
+        }
+
+        /** Makes this program the base for further incremental compilation once the caller has
+         * moved the scratch registers to their node registers.
+         */
+        void retarget() {
+            const unsigned scratch = num_of_registers();
+            for (unsigned l = 0; l != _geometry.depth(); ++l)
+                for (unsigned i = 0; i != _geometry.width(); ++i)
+                    if (_values[l][i] != none && _values[l][i] >= scratch)
+                        _values[l][i] -= num_of_nodes();
+            for (unsigned i = 0; i != num_of_outputs(); ++i)
+                if (_outputs[i] >= scratch)
+                    _outputs[i] -= num_of_nodes();
+            _instructions.clear();
+        }
+
+        unsigned input() const { return _input; }
+
+        /** Geometry of the compiled circuit, it determines the layout of the registers
+         */
+        geometry_type const& geometry() const { return _geometry; }
+
+        unsigned num_of_nodes() const { return _geometry.width() * _geometry.depth(); }
+
+        unsigned num_of_outputs() const { return _geometry.outputs(); }
+
+        /** Size of the register file, incrementally compiled programs need further num_of_nodes
+         * scratch registers.
+         */
+        unsigned num_of_registers() const { return _input + num_of_nodes(); }
+
+        register_type node_register(unsigned layer, unsigned slot) const {
+            return register_type(_input + layer * _geometry.width() + slot);
+        }
+
+        /** Registers written by incrementally compiled programs, they follow the node registers.
+         */
+        register_type scratch_register(unsigned layer, unsigned slot) const {
+            return register_type(node_register(layer, slot) + num_of_nodes());
+        }
+
+        /** Register holding the output of the node, none if the node is not live.
+         */
+        register_type value(unsigned layer, unsigned slot) const { return _values[layer][slot]; }
+
+        auto instructions() const -> view<typename std::vector<instruction>::const_iterator> {
+            return make_view(_instructions);
+        }
+
+        /** Registers holding the outputs of the circuit
+         */
+        auto outputs() const -> view<typename outputs_type::const_iterator> {
+            return make_view(_outputs.cbegin(), _outputs.cbegin() + num_of_outputs());
+        }
+
+        register_type output_register(unsigned i) const {
+            ASSERT(i < num_of_outputs());
+            return _outputs[i];
+        }
+
+        /** Hash of the computation. Circuits differing only in unused nodes, unused connectors
+         * or arguments ignored by their functions compile to the same program and hash equally.
+         * It is meaningful only for programs compiled from scratch.
+         */
+        std::uint64_t hash() const {
+            // FNV-1a
+            std::uint64_t h = 0xcbf29ce484222325ull;
+            auto mix = [&h](std::uint64_t value) {
+                h ^= value;
+                h *= 0x100000001b3ull;
+            };
+
+            mix(_input);
+            for (auto const& ins : _instructions) {
+                mix(static_cast<std::uint64_t>(ins.code) | std::uint64_t(ins.argument) << 8);
+                mix(std::uint64_t(ins.dst) | std::uint64_t(ins.a) << 16 |
+                    std::uint64_t(ins.b) << 32);
+            }
+            for (auto value : outputs())
+                mix(value);
+            return h;
+        }
+
+        /** Runs the program over @p n lanes of a register file in which the register r starts
+         * at @p registers + r * @p stride.
+         */
+        void execute(std::uint8_t* registers, std::size_t stride, std::size_t n) const noexcept {
+            execute(registers, registers + _input * stride, stride, n);
+        }
+
+        /** Runs the program over @p n lanes of a register file split in two, so that the inputs
+         * may be shared read-only: the input register r starts at @p inputs + r * @p stride and
+         * the node register r at @p nodes + (r - input) * @p stride.
+         */
+        void execute(std::uint8_t const* inputs,
+                     std::uint8_t* nodes,
+                     std::size_t stride,
+                     std::size_t n) const noexcept {
+            auto column = [=](register_type reg) -> std::uint8_t const* {
+                return reg < _input ? inputs + reg * stride : nodes + (reg - _input) * stride;
+            };
+            for (auto const& ins : _instructions)
+                execute(ins, nodes + (ins.dst - _input) * stride, column(ins.a), column(ins.b), n);
+        }
+
+        static void execute(instruction const& ins,
+                            std::uint8_t* dst,
+                            std::uint8_t const* a,
+                            std::uint8_t const* b,
+                            std::size_t n) noexcept {
+            switch (ins.code) {
+            case op::CONST:
+                simd::fill(dst, ins.argument, n);
+                return;
+            case op::AND:
+                simd::op_and(dst, a, b, n);
+                return;
+            case op::NAND:
+                simd::op_nand(dst, a, b, n);
+                return;
+            case op::OR:
+                simd::op_or(dst, a, b, n);
+                return;
+            case op::NOR:
+                simd::op_nor(dst, a, b, n);
+                return;
+            case op::XOR:
+                simd::op_xor(dst, a, b, n);
+                return;
+            case op::NOT:
+                simd::op_not(dst, a, n);
+                return;
+            case op::SHL:
+                simd::op_shl(dst, a, ins.argument, n);
+                return;
+            case op::SHR:
+                simd::op_shr(dst, a, ins.argument, n);
+                return;
+            case op::ROTL:
+                simd::op_rotl(dst, a, ins.argument, n);
+                return;
+            case op::MASK:
+                simd::op_mask(dst, a, ins.argument, n);
+                return;
+            }
+        }
+
+        std::string register_name(register_type reg) const {
+            // the same naming as used by circuit::dump_to_graph
+            if (reg < _input)
+                return "\"-1_" + std::to_string(reg) + "\"";
+            reg = (reg - _input) % num_of_nodes();
+            auto layer = std::to_string(reg / _geometry.width());
+            auto slot = std::to_string(reg % _geometry.width());
+            return "\"" + layer + "_" + slot + "\"";
+        }
+
+        void dump_to_tape(const std::string& filename) const {
+            std::ofstream of(filename);
+            of << *this;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, program const& prog) {
+            for (auto const& ins : prog._instructions) {
+                os << prog.register_name(ins.dst) << " = " << to_string(ins.code);
+                switch (ins.code) {
+                case op::CONST:
+                    os << " " << int(ins.argument);
+                    break;
+                case op::AND:
+                case op::NAND:
+                case op::OR:
+                case op::NOR:
+                case op::XOR:
+                    os << " " << prog.register_name(ins.a) << ", " << prog.register_name(ins.b);
+                    break;
+                case op::NOT:
+                    os << " " << prog.register_name(ins.a);
+                    break;
+                case op::SHL:
+                case op::SHR:
+                case op::ROTL:
+                case op::MASK:
+                    os << " " << prog.register_name(ins.a) << ", " << int(ins.argument);
+                    break;
+                }
+                os << std::endl;
+            }
+            for (unsigned i = 0; i != prog.num_of_outputs(); ++i)
+                os << "out_" << i << " = " << prog.register_name(prog._outputs[i]) << std::endl;
+            return os;
+        }
+
+    private:
+        geometry_type _geometry;
+        unsigned _input;
+        std::vector<instruction> _instructions;
+        std::array<std::array<register_type, Circuit::x>, Circuit::y> _values;
+        outputs_type _outputs;
+
+        void
+        _compile(Circuit const& circuit, mutation<Circuit> const* changes, program const* base) {
+            _geometry = circuit.geometry();
+            _input = circuit.input();
+            _instructions.clear();
+
+            using sources = std::array<register_type, Circuit::connectors_type::size>;
+            using flags = std::array<bool, Circuit::connectors_type::size>;
+
+            sources prev;
+            sources curr;
+            flags prev_fresh{};
+            flags curr_fresh{};
+
+            for (unsigned i = 0; i != _input; ++i)
+                prev[i] = register_type(i);
+
+            auto live = _liveness(circuit);
+            for (unsigned l = 0; l != _geometry.depth(); ++l) {
+                for (unsigned i = 0; i != _geometry.width(); ++i) {
+                    if (!live[l][i]) {
+                        _values[l][i] = none;
+                        continue;
+                    }
+
+                    auto const& node = circuit[l][i];
+                    const bool fresh = base == nullptr || changes->touched(l, i) ||
+                                       base->_values[l][i] == none || _reads(node, prev_fresh);
+
+                    if (!fresh)
+                        curr[i] = base->_values[l][i];
+                    else if (base == nullptr)
+                        curr[i] = _compile(node, prev, node_register(l, i));
+                    else
+                        curr[i] = _compile(node, prev, scratch_register(l, i));
+
+                    curr_fresh[i] = fresh;
+                    _values[l][i] = curr[i];
+                }
+                std::swap(prev, curr);
+                std::swap(prev_fresh, curr_fresh);
+            }
+
+            for (unsigned i = 0; i != num_of_outputs(); ++i)
+                _outputs[i] = prev[i];
+        }
+
+        template <typename Flags>
+        static bool _reads(typename Circuit::node const& node, Flags const& flags) {
+            auto arity = fn_arity(node.function);
+            auto it = node.connectors.iterator();
+            for (; arity != 0 && it.has_next(); it.next(), --arity)
+                if (flags[it])
+                    return true;
+            return false;
+        }
+
+        using liveness_type = std::array<std::array<bool, Circuit::x>, Circuit::y>;
+
+        static liveness_type _liveness(Circuit const& circuit) {
+            liveness_type live{};
+            for (unsigned i = 0; i != circuit.outputs(); ++i)
+                live[circuit.depth() - 1][i] = true;
+
+            for (unsigned l = circuit.depth() - 1; l != 0; --l) {
+                for (unsigned i = 0; i != circuit.width(); ++i) {
+                    if (!live[l][i])
+                        continue;
+
+                    auto arity = fn_arity(circuit[l][i].function);
+                    for (auto it = circuit[l][i].connectors.iterator(); arity != 0 && it.has_next();
+                         it.next(), --arity)
+                        live[l - 1][it] = true;
+                }
+            }
+            return live;
+        }
+
+        void _emit(op code, register_type dst, register_type a, register_type b, std::uint8_t arg) {
+            _instructions.push_back(instruction{code, arg, dst, a, b});
+        }
+
+        register_type _constant(register_type dst, std::uint8_t value) {
+            _emit(op::CONST, dst, dst, dst, value);
+            return dst;
+        }
+
+        register_type _unary(op code, register_type dst, register_type src, std::uint8_t arg) {
+            _emit(code, dst, src, src, arg);
+            return dst;
+        }
+
+        template <typename Iterator, typename Sources>
+        register_type _fold(op chain,
+                            op last,
+                            std::uint8_t empty,
+                            bool negate,
+                            Iterator i,
+                            Sources const& src,
+                            register_type dst) {
+            if (!i.has_next())
+                return _constant(dst, empty);
+
+            register_type acc = src[i];
+            i.next();
+            if (!i.has_next())
+                return negate ? _unary(op::NOT, dst, acc, 0u) : acc;
+
+            while (i.has_next()) {
+                register_type b = src[i];
+                i.next();
+                _emit(i.has_next() ? chain : last, dst, acc, b, 0u);
+                acc = dst;
+            }
+            return dst;
+        }
+
+        /** Compiles a node and returns the register holding its output.
+         */
+        template <typename Sources>
+        register_type
+        _compile(typename Circuit::node const& node, Sources const& src, register_type dst) {
+            auto i = node.connectors.iterator();
+            const std::uint8_t bits = 8;
+            const std::uint8_t shift = node.argument % bits;
+
+            switch (node.function) {
+            case fn::CONS:
+                return _constant(dst, node.argument);
+            case fn::AND:
+                return _fold(op::AND, op::AND, 0xff, false, i, src, dst);
+            case fn::NAND:
+                return _fold(op::AND, op::NAND, 0x00, true, i, src, dst);
+            case fn::OR:
+                return _fold(op::OR, op::OR, 0x00, false, i, src, dst);
+            case fn::NOR:
+                return _fold(op::OR, op::NOR, 0xff, true, i, src, dst);
+            case fn::XOR:
+                return _fold(op::XOR, op::XOR, 0x00, false, i, src, dst);
+            default:
+                break;
+            }
+
+            // the remaining functions are unary and give zero when nothing is connected
+            if (!i.has_next())
+                return _constant(dst, 0u);
+
+            switch (node.function) {
+            case fn::NOP:
+                return src[i];
+            case fn::NOT:
+                return _unary(op::NOT, dst, src[i], 0u);
+            case fn::SHIL:
+                return shift == 0 ? src[i] : _unary(op::SHL, dst, src[i], shift);
+            case fn::SHIR:
+                return shift == 0 ? src[i] : _unary(op::SHR, dst, src[i], shift);
+            case fn::ROTL:
+                return shift == 0 ? src[i] : _unary(op::ROTL, dst, src[i], shift);
+            case fn::ROTR:
+                return shift == 0 ? src[i] : _unary(op::ROTL, dst, src[i], bits - shift);
+            case fn::MASK:
+                if (node.argument == 0x00)
+                    return _constant(dst, 0u);
+                if (node.argument == 0xff)
+                    return src[i];
+                return _unary(op::MASK, dst, src[i], node.argument);
+            default:
+                ASSERT_UNREACHABLE();
+                return dst;
+            }
+        }
+    };
+
+    /** Transposes @p n test vectors from @p first into the first registers of a register file
+     * in which the register r starts at @p registers + r * @p stride, one vector per lane.
+     * Returns the iterator past the last transposed vector.
+     */
+    template <typename Iterator>
+    Iterator transpose(Iterator first,
+                       std::size_t n,
+                       unsigned input,
+                       std::uint8_t* registers,
+                       std::size_t stride) {
+        for (std::size_t lane = 0; lane != n; ++lane, ++first) {
+            ASSERT((*first).size() == input);
+            std::size_t i = 0;
+            for (std::uint8_t byte : *first)
+                registers[i++ * stride + lane] = byte;
+        }
+        return first;
+    }
+
+} // namespace circuit
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace circuit {
+
+    /** Byte-lane kernels executing the instructions of compiled programs.
+     *
+     * Every function processes @p n bytes; lane j of the destination depends only on lane j of
+     * the sources, so @p dst may alias any source. Blocks of native width are processed with
+     * AVX2/SSE2 (or 8-byte SWAR words when neither is available), the tail byte by byte.
+     */
+    namespace simd {
+
+#if defined(__AVX2__)
+        using block = __m256i;
+
+        inline block load(std::uint8_t const* p) {
+            return _mm256_loadu_si256(reinterpret_cast<block const*>(p));
+        }
+        inline void store(std::uint8_t* p, block b) {
+            _mm256_storeu_si256(reinterpret_cast<block*>(p), b);
+        }
+        inline block broadcast(std::uint8_t v) { return _mm256_set1_epi8(char(v)); }
+
+        inline block and_(block a, block b) { return _mm256_and_si256(a, b); }
+        inline block or_(block a, block b) { return _mm256_or_si256(a, b); }
+        inline block xor_(block a, block b) { return _mm256_xor_si256(a, b); }
+
+        inline bool equal(block a, block b) {
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == -1;
+        }
+
+        // there are no 8-bit shifts, so shift 16-bit lanes and drop bits crossing byte borders
+        inline block shl(block a, unsigned s) {
+            return and_(_mm256_sll_epi16(a, _mm_cvtsi32_si128(int(s))),
+                        broadcast(std::uint8_t(0xff << s)));
+        }
+        inline block shr(block a, unsigned s) {
+            return and_(_mm256_srl_epi16(a, _mm_cvtsi32_si128(int(s))),
+                        broadcast(std::uint8_t(0xff >> s)));
+        }
+#elif defined(__SSE2__)
+        using block = __m128i;
+
+        inline block load(std::uint8_t const* p) {
+            return _mm_loadu_si128(reinterpret_cast<block const*>(p));
+        }
+        inline void store(std::uint8_t* p, block b) {
+            _mm_storeu_si128(reinterpret_cast<block*>(p), b);
+        }
+        inline block broadcast(std::uint8_t v) { return _mm_set1_epi8(char(v)); }
+
+        inline block and_(block a, block b) { return _mm_and_si128(a, b); }
+        inline block or_(block a, block b) { return _mm_or_si128(a, b); }
+        inline block xor_(block a, block b) { return _mm_xor_si128(a, b); }
+
+        inline bool equal(block a, block b) {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xffff;
+        }
+
+        // there are no 8-bit shifts, so shift 16-bit lanes and drop bits crossing byte borders
+        inline block shl(block a, unsigned s) {
+            return and_(_mm_sll_epi16(a, _mm_cvtsi32_si128(int(s))),
+                        broadcast(std::uint8_t(0xff << s)));
+        }
+        inline block shr(block a, unsigned s) {
+            return and_(_mm_srl_epi16(a, _mm_cvtsi32_si128(int(s))),
+                        broadcast(std::uint8_t(0xff >> s)));
+        }
+#else
+        using block = std::uint64_t; // SWAR: 8 byte lanes in a machine word
+
+        inline block load(std::uint8_t const* p) {
+            block b;
+            std::memcpy(&b, p, sizeof(b));
+            return b;
+        }
+        inline void store(std::uint8_t* p, block b) { std::memcpy(p, &b, sizeof(b)); }
+        inline block broadcast(std::uint8_t v) { return v * 0x0101010101010101ull; }
+
+        inline block and_(block a, block b) { return a & b; }
+        inline block or_(block a, block b) { return a | b; }
+        inline block xor_(block a, block b) { return a ^ b; }
+
+        inline bool equal(block a, block b) { return a == b; }
+
+        inline block shl(block a, unsigned s) {
+            return (a << s) & broadcast(std::uint8_t(0xff << s));
+        }
+        inline block shr(block a, unsigned s) {
+            return (a >> s) & broadcast(std::uint8_t(0xff >> s));
+        }
+#endif
+
+        static constexpr std::size_t width = sizeof(block);
+
+        inline block not_(block a) { return xor_(a, broadcast(0xff)); }
+
+        namespace _impl {
+
+            template <typename Op>
+            void transform(std::uint8_t* dst, std::uint8_t const* a, std::size_t n, Op op) {
+                std::size_t i = 0;
+                for (; i + width <= n; i += width)
+                    store(dst + i, op(load(a + i)));
+                for (; i != n; ++i)
+                    dst[i] = op(a[i]);
+            }
+
+            template <typename Op>
+            void transform(std::uint8_t* dst,
+                           std::uint8_t const* a,
+                           std::uint8_t const* b,
+                           std::size_t n,
+                           Op op) {
+                std::size_t i = 0;
+                for (; i + width <= n; i += width)
+                    store(dst + i, op(load(a + i), load(b + i)));
+                for (; i != n; ++i)
+                    dst[i] = op(a[i], b[i]);
+            }
+
+            struct and_op {
+                block operator()(block a, block b) const { return and_(a, b); }
+                std::uint8_t operator()(std::uint8_t a, std::uint8_t b) const { return a & b; }
+            };
+
+            struct nand_op {
+                block operator()(block a, block b) const { return not_(and_(a, b)); }
+                std::uint8_t operator()(std::uint8_t a, std::uint8_t b) const { return ~(a & b); }
+            };
+
+            struct or_op {
+                block operator()(block a, block b) const { return or_(a, b); }
+                std::uint8_t operator()(std::uint8_t a, std::uint8_t b) const { return a | b; }
+            };
+
+            struct nor_op {
+                block operator()(block a, block b) const { return not_(or_(a, b)); }
+                std::uint8_t operator()(std::uint8_t a, std::uint8_t b) const { return ~(a | b); }
+            };
+
+            struct xor_op {
+                block operator()(block a, block b) const { return xor_(a, b); }
+                std::uint8_t operator()(std::uint8_t a, std::uint8_t b) const { return a ^ b; }
+            };
+
+            struct not_op {
+                block operator()(block a) const { return not_(a); }
+                std::uint8_t operator()(std::uint8_t a) const { return ~a; }
+            };
+
+            struct mask_op {
+                mask_op(std::uint8_t m)
+                    : _b(broadcast(m))
+                    , _m(m) {}
+
+                block operator()(block a) const { return and_(a, _b); }
+                std::uint8_t operator()(std::uint8_t a) const { return a & _m; }
+
+            private:
+                block _b;
+                std::uint8_t _m;
+            };
+
+            struct shl_op {
+                shl_op(unsigned s)
+                    : _s(s) {}
+
+                block operator()(block a) const { return shl(a, _s); }
+                std::uint8_t operator()(std::uint8_t a) const { return std::uint8_t(a << _s); }
+
+            private:
+                unsigned _s;
+            };
+
+            struct shr_op {
+                shr_op(unsigned s)
+                    : _s(s) {}
+
+                block operator()(block a) const { return shr(a, _s); }
+                std::uint8_t operator()(std::uint8_t a) const { return std::uint8_t(a >> _s); }
+
+            private:
+                unsigned _s;
+            };
+
+            // rotation by s in [1, 7] to the left; rotation to the right is rotl by 8 - s
+            struct rotl_op {
+                rotl_op(unsigned s)
+                    : _s(s) {}
+
+                block operator()(block a) const { return or_(shl(a, _s), shr(a, 8 - _s)); }
+                std::uint8_t operator()(std::uint8_t a) const {
+                    return std::uint8_t((a << _s) | (a >> (8 - _s)));
+                }
+
+            private:
+                unsigned _s;
+            };
+
+        } // namespace _impl
+
+        inline void fill(std::uint8_t* dst, std::uint8_t value, std::size_t n) {
+            std::memset(dst, value, n);
+        }
+
+        inline void copy(std::uint8_t* dst, std::uint8_t const* a, std::size_t n) {
+            if (dst != a)
+                std::memmove(dst, a, n);
+        }
+
+        inline void op_and(std::uint8_t* dst,
+                           std::uint8_t const* a,
+                           std::uint8_t const* b,
+                           std::size_t n) {
+            _impl::transform(dst, a, b, n, _impl::and_op{});
+        }
+
+        inline void op_nand(std::uint8_t* dst,
+                            std::uint8_t const* a,
+                            std::uint8_t const* b,
+                            std::size_t n) {
+            _impl::transform(dst, a, b, n, _impl::nand_op{});
+        }
+
+        inline void op_or(std::uint8_t* dst,
+                          std::uint8_t const* a,
+                          std::uint8_t const* b,
+                          std::size_t n) {
+            _impl::transform(dst, a, b, n, _impl::or_op{});
+        }
+
+        inline void op_nor(std::uint8_t* dst,
+                           std::uint8_t const* a,
+                           std::uint8_t const* b,
+                           std::size_t n) {
+            _impl::transform(dst, a, b, n, _impl::nor_op{});
+        }
+
+        inline void op_xor(std::uint8_t* dst,
+                           std::uint8_t const* a,
+                           std::uint8_t const* b,
+                           std::size_t n) {
+            _impl::transform(dst, a, b, n, _impl::xor_op{});
+        }
+
+        inline void op_not(std::uint8_t* dst, std::uint8_t const* a, std::size_t n) {
+            _impl::transform(dst, a, n, _impl::not_op{});
+        }
+
+        inline void op_mask(std::uint8_t* dst,
+                            std::uint8_t const* a,
+                            std::uint8_t m,
+                            std::size_t n) {
+            _impl::transform(dst, a, n, _impl::mask_op{m});
+        }
+
+        inline void op_shl(std::uint8_t* dst, std::uint8_t const* a, unsigned s, std::size_t n) {
+            if (s == 0)
+                copy(dst, a, n);
+            else
+                _impl::transform(dst, a, n, _impl::shl_op{s});
+        }
+
+        inline void op_shr(std::uint8_t* dst, std::uint8_t const* a, unsigned s, std::size_t n) {
+            if (s == 0)
+                copy(dst, a, n);
+            else
+                _impl::transform(dst, a, n, _impl::shr_op{s});
+        }
+
+        inline void op_rotl(std::uint8_t* dst, std::uint8_t const* a, unsigned s, std::size_t n) {
+            if (s == 0)
+                copy(dst, a, n);
+            else
+                _impl::transform(dst, a, n, _impl::rotl_op{s});
+        }
+
+    } // namespace simd
+
+} // namespace circuit
@@ -0,0 +1,259 @@
+#include "dataset_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+namespace {
+
+    const char magic[8] = {'E', 'A', 'C', 'D', 'C', 'H', 0, 1};
+
+    struct entry {
+        std::string path;
+        std::uint64_t size;
+        std::time_t modified;
+    };
+
+    std::uint64_t fnv1a(std::uint8_t const* data, std::size_t size, std::uint64_t h) {
+        for (std::size_t i = 0; i != size; ++i) {
+            h ^= data[i];
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    std::uint64_t fnv1a(std::string const& s) {
+        return fnv1a(reinterpret_cast<std::uint8_t const*>(s.data()), s.size(),
+                     0xcbf29ce484222325ull);
+    }
+
+    std::uint64_t checksum(std::vector<std::uint8_t> const& data) {
+        return fnv1a(data.data(), data.size(), 0xcbf29ce484222325ull);
+    }
+
+#ifdef _WIN32
+    void make_directory(std::string const& path) { _mkdir(path.c_str()); }
+
+    void touch(std::string const& path) { _utime(path.c_str(), nullptr); }
+
+    std::vector<entry> list_entries(std::string const& path) {
+        std::vector<entry> entries;
+        WIN32_FIND_DATAA data;
+        HANDLE dir = FindFirstFileA((path + "\\*.dat").c_str(), &data);
+        if (dir == INVALID_HANDLE_VALUE)
+            return entries;
+        do {
+            struct _stat info;
+            const std::string file = path + "\\" + data.cFileName;
+            if (_stat(file.c_str(), &info) == 0)
+                entries.push_back({file, std::uint64_t(info.st_size), info.st_mtime});
+        } while (FindNextFileA(dir, &data));
+        FindClose(dir);
+        return entries;
+    }
+#else
+    void make_directory(std::string const& path) { ::mkdir(path.c_str(), 0755); }
+
+    void touch(std::string const& path) { ::utime(path.c_str(), nullptr); }
+
+    std::vector<entry> list_entries(std::string const& path) {
+        std::vector<entry> entries;
+        DIR* dir = ::opendir(path.c_str());
+        if (dir == nullptr)
+            return entries;
+        while (dirent* d = ::readdir(dir)) {
+            const std::string name = d->d_name;
+            if (name.size() < 4 || name.compare(name.size() - 4, 4, ".dat") != 0)
+                continue;
+            struct stat info;
+            const std::string file = path + "/" + name;
+            if (::stat(file.c_str(), &info) == 0)
+                entries.push_back({file, std::uint64_t(info.st_size), info.st_mtime});
+        }
+        ::closedir(dir);
+        return entries;
+    }
+#endif
+
+    bool read_u64(std::FILE* f, std::uint64_t& value) {
+        return std::fread(&value, sizeof(value), 1, f) == 1;
+    }
+
+    bool write_u64(std::FILE* f, std::uint64_t value) {
+        return std::fwrite(&value, sizeof(value), 1, f) == 1;
+    }
+
+} // namespace
+
+dataset_cache::dataset_cache(json const& config)
+    : _path(config.at("path"))
+    , _size_limit(config.at("size-limit"))
+    , _size(0)
+    , _hits(0)
+    , _misses(0)
+    , _num_of_stores(0) {
+    make_directory(_path);
+    for (auto const& e : list_entries(_path))
+        _size += e.size;
+    if (_size > _size_limit)
+        _evict();
+}
+
+bool dataset_cache::load(std::string const& key, std::vector<std::uint8_t>& data) {
+    const std::string file = _file(key);
+
+    bool valid = false;
+    std::uint64_t removed = 0;
+    if (std::FILE* f = std::fopen(file.c_str(), "rb")) {
+        std::uint64_t file_size = 0;
+        if (std::fseek(f, 0, SEEK_END) == 0) {
+            const long end = std::ftell(f);
+            file_size = end > 0 ? std::uint64_t(end) : 0u;
+        }
+        std::rewind(f);
+
+        char header[sizeof(magic)];
+        std::uint64_t key_size = 0;
+        std::uint64_t data_size = 0;
+        std::uint64_t sum = 0;
+        std::string stored_key;
+
+        valid = std::fread(header, sizeof(header), 1, f) == 1 &&
+                std::memcmp(header, magic, sizeof(magic)) == 0 && read_u64(f, key_size) &&
+                key_size == key.size();
+        if (valid) {
+            stored_key.resize(key.size());
+            valid = std::fread(&stored_key[0], 1, key.size(), f) == key.size() &&
+                    stored_key == key && read_u64(f, data_size) && data_size == data.size() &&
+                    read_u64(f, sum) && std::fread(data.data(), 1, data.size(), f) == data.size() &&
+                    std::fgetc(f) == EOF && checksum(data) == sum;
+        }
+        std::fclose(f);
+
+        if (valid)
+            touch(file);
+        else if (std::remove(file.c_str()) == 0)
+            removed = file_size;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++(valid ? _hits : _misses);
+    _size -= std::min(_size, removed);
+    return valid;
+}
+
+void dataset_cache::store(std::string const& key, std::vector<std::uint8_t> const& data) {
+    const std::string file = _file(key);
+
+    std::string temporary;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        temporary = file + "." + std::to_string(++_num_of_stores) + ".tmp";
+    }
+
+    std::FILE* f = std::fopen(temporary.c_str(), "wb");
+    if (f == nullptr)
+        throw std::runtime_error("can't write into the dataset cache " + _path);
+
+    const bool written = std::fwrite(magic, sizeof(magic), 1, f) == 1 &&
+                         write_u64(f, key.size()) &&
+                         std::fwrite(key.data(), 1, key.size(), f) == key.size() &&
+                         write_u64(f, data.size()) && write_u64(f, checksum(data)) &&
+                         std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (std::fclose(f) != 0 || !written) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("can't write into the dataset cache " + _path);
+    }
+
+    std::remove(file.c_str());
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return; // another run has just stored the same entry
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _size += sizeof(magic) + 3 * sizeof(std::uint64_t) + key.size() + data.size();
+    if (_size > _size_limit)
+        _evict();
+}
+
+std::string dataset_cache::_file(std::string const& key) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fnv1a(key)));
+    return _path + "/" + name + ".dat";
+}
+
+void dataset_cache::_evict() {
+    auto entries = list_entries(_path);
+    std::sort(entries.begin(), entries.end(), [](entry const& lhs, entry const& rhs) {
+        return lhs.modified < rhs.modified;
+    });
+
+    _size = 0;
+    for (auto const& e : entries)
+        _size += e.size;
+
+    for (auto const& e : entries) {
+        if (_size <= _size_limit)
+            break;
+        if (std::remove(e.path.c_str()) == 0)
+            _size -= e.size;
+    }
+}
+
+cached_stream::cached_stream(std::unique_ptr<stream> source,
+                             dataset_cache& cache,
+                             std::string key,
+                             std::size_t osize,
+                             std::uint64_t vectors_per_chunk)
+    : stream(osize)
+    , _source(std::move(source))
+    , _cache(cache)
+    , _key(std::move(key))
+    , _vector_size(osize)
+    , _vectors_per_chunk(vectors_per_chunk)
+    , _chunk(osize * vectors_per_chunk)
+    , _position(vectors_per_chunk)
+    , _next_chunk(0)
+    , _source_chunk(0) {}
+
+vec_view cached_stream::next() {
+    if (_position == _vectors_per_chunk)
+        _load();
+
+    std::uint8_t const* data = _chunk.data() + _position++ * _vector_size;
+    return make_view(data, _vector_size);
+}
+
+void cached_stream::_load() {
+    const std::uint64_t chunk = _next_chunk++;
+    _position = 0;
+
+    if (_cache.load(_key + "|chunk:" + std::to_string(chunk), _chunk))
+        return;
+
+    // bring the source to the missing chunk, the chunks it passes are in the cache already
+    while (_source_chunk != chunk)
+        _generate();
+    _generate();
+    _cache.store(_key + "|chunk:" + std::to_string(chunk), _chunk);
+}
+
+void cached_stream::_generate() {
+    for (std::uint64_t i = 0; i != _vectors_per_chunk; ++i) {
+        vec_view vec = _source->next();
+        std::copy(vec.begin(), vec.end(), _chunk.begin() + std::ptrdiff_t(i * _vector_size));
+    }
+    ++_source_chunk;
+}
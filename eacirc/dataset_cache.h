@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <eacirc-core/json.h>
+#include <eacirc-streams/stream.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** On-disk cache of data generated by streams.
+ *
+ * Entries are files named by a hash of their key. Each file holds the key itself and a checksum
+ * of the data, both verified on load, so collisions and damaged files are treated as misses.
+ * When the total size exceeds the limit, the least recently used entries are removed; loading
+ * an entry refreshes its modification time. Entries are written into temporary files which are
+ * then renamed, so more runs can share the cache directory.
+ */
+struct dataset_cache {
+    dataset_cache(json const& config);
+
+    bool load(std::string const& key, std::vector<std::uint8_t>& data);
+    void store(std::string const& key, std::vector<std::uint8_t> const& data);
+
+    std::uint64_t hits() const { return _hits; }
+    std::uint64_t misses() const { return _misses; }
+    std::uint64_t stores() const { return _num_of_stores; }
+
+private:
+    const std::string _path;
+    const std::uint64_t _size_limit;
+
+    std::mutex _mutex;
+    std::uint64_t _size;
+    std::uint64_t _hits;
+    std::uint64_t _misses;
+    std::uint64_t _num_of_stores;
+
+    std::string _file(std::string const& key) const;
+    void _evict();
+};
+
+/** Stream serving data of another stream from the cache, where the data are stored in chunks.
+ *
+ * The underlying stream is used only for chunks missing in the cache. As it can only be read
+ * sequentially, chunks preceding a missing one which were served from the cache are generated
+ * again first. Only the missing chunk is stored then.
+ */
+struct cached_stream : stream {
+    cached_stream(std::unique_ptr<stream> source,
+                  dataset_cache& cache,
+                  std::string key,
+                  std::size_t osize,
+                  std::uint64_t vectors_per_chunk);
+
+    vec_view next() override;
+
+private:
+    std::unique_ptr<stream> _source;
+    dataset_cache& _cache;
+    const std::string _key;
+    const std::size_t _vector_size;
+    const std::uint64_t _vectors_per_chunk;
+
+    std::vector<std::uint8_t> _chunk;
+    std::uint64_t _position;       // index of the next vector within the chunk
+    std::uint64_t _next_chunk;     // index of the chunk to be loaded next
+    std::uint64_t _source_chunk;   // index of the chunk the source would generate next
+
+    void _load();
+    void _generate();
+};
@@ -0,0 +1,81 @@
+#include "dataset_producer.h"
+#include <eacirc-streams/streams.h>
+
+dataset_producer::dataset_producer(std::unique_ptr<stream>& stream_a,
+                                   std::unique_ptr<stream>& stream_b,
+                                   unsigned tv_size,
+                                   std::uint64_t tv_count,
+                                   std::uint64_t num_of_epochs)
+    : _streams{{&stream_a, &stream_b}}
+    , _num_of_epochs(num_of_epochs)
+    , _initial(_allocate(tv_size, tv_count))
+    , _ring{{_allocate(tv_size, tv_count), _allocate(tv_size, tv_count)}}
+    , _produced{{0, 0}}
+    , _consumed(0)
+    , _released(0)
+    , _stop(false)
+    , _threads{{std::thread([this] { _produce(0); }), std::thread([this] { _produce(1); })}} {}
+
+dataset_producer::~dataset_producer() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+dataset_producer::pair const& dataset_producer::next() {
+    _wait_for(_consumed + 1);
+    return _ring[_consumed++ % slots];
+}
+
+void dataset_producer::release() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_released + 1 < _consumed)
+            ++_released;
+    }
+    _changed.notify_all();
+}
+
+dataset_producer::pair dataset_producer::_allocate(unsigned tv_size, std::uint64_t tv_count) {
+    return {dataset{tv_size, tv_count}, dataset{tv_size, tv_count}};
+}
+
+void dataset_producer::_wait_for(std::uint64_t produced) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [&] {
+        return _error || (_produced[0] >= produced && _produced[1] >= produced);
+    });
+    if (_error)
+        std::rethrow_exception(_error);
+}
+
+void dataset_producer::_produce(unsigned which) {
+    try {
+        // datasets of the epochs are followed by the same number of chunks of the final ones
+        for (std::uint64_t i = 0; i != 2 * _num_of_epochs; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _changed.wait(lock, [&] { return _stop || i < _released + slots; });
+                if (_stop)
+                    return;
+            }
+
+            stream_to_dataset(_select(_ring[i % slots], which), *_streams[which]);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                ++_produced[which];
+            }
+            _changed.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error)
+            _error = std::current_exception();
+        _changed.notify_all();
+    }
+}
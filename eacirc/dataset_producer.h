@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <eacirc-core/dataset.h>
+#include <eacirc-streams/stream.h>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/** Fills datasets of the epochs and the final datasets from two streams on background threads.
+ *
+ * The datasets of an epoch are generated while the backend is still training on the previous
+ * ones. They are produced into a ring of two preallocated pairs, so the producer runs at most
+ * one epoch ahead. The final datasets, as large as those of all epochs together, follow as
+ * chunks of the epoch size through the same ring, so the memory does not grow with the number
+ * of epochs. The streams are independent, so each one is read by a thread of its own. Each
+ * stream is read in the same order as by the sequential loop, thus the datasets do not depend
+ * on the timing.
+ */
+struct dataset_producer {
+    struct pair {
+        dataset a;
+        dataset b;
+    };
+
+    dataset_producer(std::unique_ptr<stream>& stream_a,
+                     std::unique_ptr<stream>& stream_b,
+                     unsigned tv_size,
+                     std::uint64_t tv_count,
+                     std::uint64_t num_of_epochs);
+
+    dataset_producer(dataset_producer const&) = delete;
+    dataset_producer& operator=(dataset_producer const&) = delete;
+
+    ~dataset_producer();
+
+    /** Zero filled datasets used before the first epoch
+     */
+    pair const& initial() const { return _initial; }
+
+    /** Waits for the datasets of the next epoch or, after all epochs, the next final chunk
+     *
+     * When fewer epochs are run, the datasets of the following epochs are the final chunks.
+     */
+    pair const& next();
+
+    /** Marks the datasets returned by the next() before the last one as no longer used
+     */
+    void release();
+
+private:
+    static constexpr std::uint64_t slots = 2;
+
+    std::array<std::unique_ptr<stream>*, 2> _streams;
+    const std::uint64_t _num_of_epochs;
+
+    pair _initial;
+    std::array<pair, slots> _ring;
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::array<std::uint64_t, 2> _produced; // datasets ready for each stream
+    std::uint64_t _consumed;                // pairs returned by next()
+    std::uint64_t _released;                // pairs which may be overwritten
+    std::exception_ptr _error;
+    bool _stop;
+
+    std::array<std::thread, 2> _threads;
+
+    static pair _allocate(unsigned tv_size, std::uint64_t tv_count);
+    static dataset& _select(pair& p, unsigned which) { return which == 0 ? p.a : p.b; }
+
+    void _produce(unsigned which);
+    void _wait_for(std::uint64_t produced);
+};
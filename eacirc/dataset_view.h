@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <eacirc-core/dataset.h>
+#include <eacirc-core/view.h>
+#include <iterator>
+
+/** Non-owning view of a range of test vectors of a dataset.
+ *
+ * It is cheap to copy and lets datasets be passed to backends and evaluators, or split into
+ * parts, without copying the data. The viewed dataset has to outlive the view.
+ */
+struct dataset_view {
+    struct iterator : std::iterator<std::forward_iterator_tag, view<std::uint8_t const*>> {
+        iterator(std::uint8_t const* ptr, std::size_t tvsize)
+            : _ptr(ptr)
+            , _tvsize(tvsize) {}
+
+        view<std::uint8_t const*> operator*() const { return make_view(_ptr, _tvsize); }
+
+        iterator& operator++() {
+            _ptr += _tvsize;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(iterator const& rhs) const { return _ptr == rhs._ptr; }
+        bool operator!=(iterator const& rhs) const { return _ptr != rhs._ptr; }
+
+    private:
+        std::uint8_t const* _ptr;
+        std::size_t _tvsize;
+    };
+
+    dataset_view()
+        : _data(nullptr)
+        , _tvsize(0)
+        , _size(0) {}
+
+    dataset_view(dataset const& set)
+        : dataset_view(set, 0, set.num_of_tvs()) {}
+
+    dataset_view(dataset const& set, std::size_t first, std::size_t size)
+        : _data(set.rawdata() + first * set.tvsize())
+        , _tvsize(set.tvsize())
+        , _size(size) {}
+
+    iterator begin() const { return {_data, _tvsize}; }
+    iterator end() const { return {_data + _size * _tvsize, _tvsize}; }
+
+    std::size_t tvsize() const { return _tvsize; }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    /** View of @p size test vectors starting with the @p first one of this view
+     */
+    dataset_view subview(std::size_t first, std::size_t size) const {
+        dataset_view sub(*this);
+        sub._data += first * _tvsize;
+        sub._size = size;
+        return sub;
+    }
+
+private:
+    std::uint8_t const* _data;
+    std::size_t _tvsize;
+    std::size_t _size;
+};
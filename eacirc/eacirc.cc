@@ -2,11 +2,18 @@
 #include "statistics.h"
 #include <eacirc-core/version.h>
 #include <eacirc-core/logger.h>
+#include <eacirc-core/memory.h>
 #include <eacirc-core/random.h>
+#include <array>
 #include <fstream>
+#include <mutex>
 #include <pcg/pcg_random.hpp>
+#include <solvers/thread_pool.h>
+#include <thread>
 
 #include "circuit/backend.h"
+#include "dataset_producer.h"
+#include "file_stream.h"
 #include <eacirc-streams/stream.h>
 #include <eacirc-streams/streams.h>
 
@@ -20,51 +27,199 @@ static std::ifstream open_config_file(std::string path) {
 eacirc::eacirc(std::string config)
     : eacirc(open_config_file(config)) {}
 
+static std::unique_ptr<backend>
+create_backend(json const& config, unsigned tv_size, default_seed_source& seeder) {
+    std::string backend_type = config.at("type");
+    if (backend_type == "circuit")
+        return circuit::create_backend(tv_size, config, seeder);
+    throw std::runtime_error("no backend named [" + backend_type + "] is available");
+}
+
 eacirc::eacirc(json const& config)
     : _config(config)
     , _seed(seed::create(config.at("seed")))
     , _num_of_epochs(config.at("num-of-epochs"))
     , _significance_level(config.at("significance-level"))
     , _tv_size(config.at("tv-size"))
-    , _tv_count(config.at("tv-count")) {
+    , _tv_count(config.at("tv-count"))
+    , _num_of_runs(config.value("num-of-runs", std::uint64_t(1)))
+    , _num_of_threads(config.value("threads", 1u))
+    , _sequential_test(config.value("sequential-test", false)) {
     logger::info() << "eacirc framework version: " << VERSION_TAG << std::endl;
     logger::info() << "current date: " << logger::date() << std::endl;
     logger::info() << "using seed: " << std::string(_seed) << std::endl;
 
+    if (_num_of_runs == 0)
+        throw std::runtime_error("the number of runs can't be zero");
+
+    if (config.count("dataset-cache") != 0)
+        _dataset_cache = std::make_unique<dataset_cache>(config.at("dataset-cache"));
+
     seed_seq_from<pcg32> main_seeder(_seed);
 
-    {
-        logger::info() << "stream a: type: " << config.at("stream-a").at("type") << std::endl;
-        _stream_a = make_stream(config.at("stream-a"), main_seeder, _tv_size);
-        logger::info() << "stream b: type: " << config.at("stream-b").at("type") << std::endl;
-        _stream_b = make_stream(config.at("stream-b"), main_seeder, _tv_size);
+    logger::info() << "stream a: type: " << config.at("stream-a").at("type") << std::endl;
+    logger::info() << "stream b: type: " << config.at("stream-b").at("type") << std::endl;
+
+    if (_num_of_runs == 1) {
+        _stream_a = _create_stream("stream-a", main_seeder, 0);
+        _stream_b = _create_stream("stream-b", main_seeder, 0);
+        _backend = create_backend(config.at("backend"), _tv_size, main_seeder);
+        return;
     }
 
-    {
-        std::string backend_type = config.at("backend").at("type");
-        if (backend_type == "circuit")
-            _backend = circuit::create_backend(_tv_size, config.at("backend"), main_seeder);
-        else
-            throw std::runtime_error("no backend named [" + backend_type + "] is available");
+    // every run seeds its streams and backend on its own, so it doesn't matter which thread
+    // runs it and when
+    for (std::uint64_t i = 0; i != _num_of_runs; ++i) {
+        std::array<std::uint32_t, 2> words;
+        main_seeder.generate(words.begin(), words.end());
+        _run_seeds.emplace_back(std::uint64_t(words[1]) << 32 | words[0]);
     }
 }
 
 void eacirc::run() {
-    std::vector<double> pvalues;
-    pvalues.reserve(_num_of_epochs);
+    if (_num_of_runs != 1) {
+        _run_independent();
+        return;
+    }
 
-    dataset a{_tv_size, _tv_count};
-    dataset b{_tv_size, _tv_count};
+    const outcome result = _run_epochs(*_backend, _stream_a, _stream_b);
+    _report(result.pvalues);
+    _log_sequential_test(result, "");
+
+    logger::info() << "The p-value of the last individual is: " << result.final_pvalue
+                   << std::endl;
+    _log_dataset_cache();
+}
+
+void eacirc::_run_independent() {
+    const unsigned threads =
+            _num_of_threads != 0 ? _num_of_threads : std::thread::hardware_concurrency();
+    logger::info() << "running " << _num_of_runs << " independent runs on " << threads
+                   << " threads" << std::endl;
+
+    std::vector<outcome> results(_num_of_runs);
+    std::mutex mutex;
+
+    solvers::thread_pool pool(threads);
+    pool.run_each(_num_of_runs, [&](std::size_t i) {
+        seed_seq_from<pcg32> seeder(_run_seeds[i]);
+        auto stream_a = _create_stream("stream-a", seeder, i);
+        auto stream_b = _create_stream("stream-b", seeder, i);
+
+        json config = _config.at("backend");
+        config["scores-file"] = "scores-" + std::to_string(i) + ".txt";
+        auto back = create_backend(config, _tv_size, seeder);
+
+        results[i] = _run_epochs(*back, stream_a, stream_b);
+
+        // the backend reports its statistics when destroyed
+        std::lock_guard<std::mutex> lock(mutex);
+        back.reset();
+    });
+
+    std::vector<double> all;
+    for (auto const& run : results)
+        all.insert(all.end(), run.pvalues.begin(), run.pvalues.end());
+    _report(all);
+
+    for (std::size_t i = 0; i != results.size(); ++i) {
+        _log_sequential_test(results[i], " of run " + std::to_string(i));
+        logger::info() << "The p-value of the last individual of run " << i
+                       << " is: " << results[i].final_pvalue << std::endl;
+    }
+    _log_dataset_cache();
+}
+
+void eacirc::_log_sequential_test(outcome const& result, std::string const& run) const {
+    if (!_sequential_test)
+        return;
+    // the sequential test only stops early, the outcome is the one of the regular test
+    const ks_uniformity_test test{result.pvalues, _significance_level};
+    const bool rejected = test.test_statistic > test.critical_value;
+    logger::info() << "sequential KS test" << run << ": uniformity hypothesis "
+                   << (rejected ? "rejected" : "accepted") << " after " << result.epochs
+                   << " of " << _num_of_epochs << " epochs" << std::endl;
+}
+
+void eacirc::_log_dataset_cache() const {
+    if (_dataset_cache)
+        logger::info() << "dataset cache hits: " << _dataset_cache->hits()
+                       << ", misses: " << _dataset_cache->misses() << std::endl;
+}
+
+std::uint64_t eacirc::_required() const {
+    // datasets of all epochs and then the final datasets of the same size
+    return 2 * _num_of_epochs * _tv_count * _tv_size;
+}
+
+std::unique_ptr<stream> eacirc::_create_stream(std::string const& name,
+                                               default_seed_source& seeder,
+                                               std::uint64_t run) const {
+    json const& config = _config.at(name);
+    std::string type = config.at("type");
+
+    // file streams of independent runs replay consecutive parts of the file
+    if (type == "file-stream")
+        return std::make_unique<file_stream>(config, _tv_size, run * _required(), _required());
+
+    auto source = make_stream(config, seeder, _tv_size);
+    if (!_dataset_cache)
+        return source;
+
+    // the data depend on the seeds drawn before the stream is created, thus on the seed, on the
+    // run and on the configuration of both streams; the chunks hold tv-count test vectors
+    const std::string key = "seed:" + std::string(_seed) + "|run:" +
+                            (_num_of_runs == 1 ? std::string("-") : std::to_string(run)) +
+                            "|tv-size:" + std::to_string(_tv_size) +
+                            "|tv-count:" + std::to_string(_tv_count) + "|stream-a:" +
+                            _config.at("stream-a").dump() + "|stream-b:" +
+                            _config.at("stream-b").dump() + "|" + name;
+    return std::make_unique<cached_stream>(
+            std::move(source), *_dataset_cache, key, _tv_size, _tv_count);
+}
+
+eacirc::outcome eacirc::_run_epochs(backend& back,
+                                    std::unique_ptr<stream>& stream_a,
+                                    std::unique_ptr<stream>& stream_b) const {
+    outcome result;
+    result.pvalues.reserve(_num_of_epochs);
+
+    std::unique_ptr<sequential_ks_test> sequential;
+    if (_sequential_test)
+        sequential = std::make_unique<sequential_ks_test>(_num_of_epochs, _significance_level);
+
+    // the datasets of an epoch are generated while training on the ones of the previous epoch
+    dataset_producer producer(stream_a, stream_b, _tv_size, _tv_count, _num_of_epochs);
+    dataset_producer::pair const* current = &producer.initial();
 
     for (std::size_t i = 0; i != _num_of_epochs; ++i) {
-        _backend->train(a, b);
+        back.train(current->a, current->b);
+
+        current = &producer.next();
+        result.pvalues.emplace_back(back.test(current->a, current->b));
 
-        stream_to_dataset(a, _stream_a);
-        stream_to_dataset(b, _stream_b);
+        // the backend now refers only to the current datasets
+        producer.release();
 
-        pvalues.emplace_back(_backend->test(a, b));
+        if (sequential &&
+            sequential->look(result.pvalues) != sequential_ks_test::decision::undecided)
+            break;
     }
+    result.epochs = result.pvalues.size();
+
+    // the final datasets are tested chunk by chunk, so they are never held as a whole; they are
+    // as large as the datasets of the epochs run, which come first from the producer
+    back.begin_test();
+    for (std::uint64_t i = 0; i != result.epochs; ++i) {
+        auto const& chunk = producer.next();
+        back.test_chunk(chunk.a, chunk.b);
+        producer.release();
+    }
+    result.final_pvalue = back.end_test();
+    return result;
+}
 
+void eacirc::_report(std::vector<double> const& pvalues) const {
     {
         std::ofstream of("pvals.txt");
         for (auto v : pvalues)
@@ -85,12 +240,4 @@ void eacirc::run() {
         logger::info() << "KS is not in " << _significance_level
                        << "% interval -> uniformity hypothesis accepted" << std::endl;
     }
-
-    dataset final_a{_tv_size, _tv_count * _num_of_epochs};
-    dataset final_b{_tv_size, _tv_count * _num_of_epochs};
-
-    stream_to_dataset(final_a, _stream_a);
-    stream_to_dataset(final_b, _stream_b);
-
-    logger::info() << "The p-value of the last individual is: " << _backend->test(final_a, final_b) << std::endl;
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "backend.h"
+#include "dataset_cache.h"
+#include "statistics.h"
 #include <eacirc-core/seed.h>
 #include <eacirc-core/json.h>
+#include <eacirc-core/random.h>
 #include <eacirc-streams/stream.h>
 #include <memory>
+#include <vector>
 
 struct eacirc {
     eacirc(std::string cofig);
@@ -30,8 +34,41 @@ private:
     const unsigned _significance_level;
     const unsigned _tv_size;
     const std::uint64_t _tv_count;
+    const std::uint64_t _num_of_runs;
+    const unsigned _num_of_threads;
+    const bool _sequential_test;
+
+    // has to outlive the streams, which may refer to it
+    std::unique_ptr<dataset_cache> _dataset_cache;
 
     std::unique_ptr<backend> _backend;
     std::unique_ptr<stream> _stream_a;
     std::unique_ptr<stream> _stream_b;
+
+    // seeds of the independent runs, when there are more of them
+    std::vector<std::uint64_t> _run_seeds;
+
+    struct outcome {
+        std::vector<double> pvalues;
+        double final_pvalue;
+        // epochs actually run, fewer when the sequential test decided early
+        std::uint64_t epochs;
+    };
+
+    void _run_independent();
+
+    /** Number of bytes a run reads from each stream
+     */
+    std::uint64_t _required() const;
+
+    /** Creates the stream @p name of the run, i.e. stream-a or stream-b
+     */
+    std::unique_ptr<stream>
+    _create_stream(std::string const& name, default_seed_source& seeder, std::uint64_t run) const;
+
+    outcome
+    _run_epochs(backend& back, std::unique_ptr<stream>& a, std::unique_ptr<stream>& b) const;
+    void _report(std::vector<double> const& pvalues) const;
+    void _log_sequential_test(outcome const& result, std::string const& run) const;
+    void _log_dataset_cache() const;
 };
@@ -0,0 +1,219 @@
+#include "file_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(std::string const& path)
+    : _data(nullptr)
+    , _size(0)
+    , _mapping(nullptr) {
+    HANDLE file = CreateFileA(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("can't open file " + path);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("can't get size of file " + path);
+    }
+    _size = std::uint64_t(size.QuadPart);
+
+    if (_size != 0) {
+        _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping != nullptr)
+            _data = static_cast<std::uint8_t const*>(
+                    MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    CloseHandle(file);
+    if (_size != 0 && _data == nullptr) {
+        if (_mapping != nullptr)
+            CloseHandle(_mapping);
+        throw std::runtime_error("can't map file " + path);
+    }
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+    : _data(other._data)
+    , _size(other._size)
+    , _mapping(other._mapping) {
+    other._data = nullptr;
+    other._size = 0;
+    other._mapping = nullptr;
+}
+
+mapped_file::~mapped_file() {
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+}
+
+static std::vector<std::string> list_shards(std::string const& path) {
+    const DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+        throw std::runtime_error("can't open file " + path);
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return {path};
+
+    std::vector<std::string> shards;
+    WIN32_FIND_DATAA entry;
+    HANDLE dir = FindFirstFileA((path + "\\*").c_str(), &entry);
+    if (dir == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("can't open directory " + path);
+    do {
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            shards.emplace_back(path + "\\" + entry.cFileName);
+    } while (FindNextFileA(dir, &entry));
+    FindClose(dir);
+
+    std::sort(shards.begin(), shards.end());
+    return shards;
+}
+
+#else
+
+mapped_file::mapped_file(std::string const& path)
+    : _data(nullptr)
+    , _size(0) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("can't open file " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("can't get size of file " + path);
+    }
+    _size = std::uint64_t(info.st_size);
+
+    if (_size != 0) {
+        void* data = ::mmap(nullptr, std::size_t(_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("can't map file " + path);
+        }
+        // the data are read only once and from the beginning to the end
+        ::madvise(data, std::size_t(_size), MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        _data = static_cast<std::uint8_t const*>(data);
+    }
+    ::close(fd);
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+    : _data(other._data)
+    , _size(other._size) {
+    other._data = nullptr;
+    other._size = 0;
+}
+
+mapped_file::~mapped_file() {
+    if (_data != nullptr)
+        ::munmap(const_cast<std::uint8_t*>(_data), std::size_t(_size));
+}
+
+static std::vector<std::string> list_shards(std::string const& path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+        throw std::runtime_error("can't open file " + path);
+    if (!S_ISDIR(info.st_mode))
+        return {path};
+
+    std::vector<std::string> shards;
+    DIR* dir = ::opendir(path.c_str());
+    if (dir == nullptr)
+        throw std::runtime_error("can't open directory " + path);
+    while (dirent* entry = ::readdir(dir)) {
+        const std::string shard = path + "/" + entry->d_name;
+        if (::stat(shard.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            shards.emplace_back(shard);
+    }
+    ::closedir(dir);
+
+    std::sort(shards.begin(), shards.end());
+    return shards;
+}
+
+#endif
+
+file_stream::file_stream(json const& config,
+                         std::size_t osize,
+                         std::uint64_t first,
+                         std::uint64_t required)
+    : stream(osize)
+    , _shard(0)
+    , _offset(first)
+    , _vector_size(osize)
+    , _buffer(osize) {
+    const std::string path = config.at("path");
+
+    std::uint64_t size = 0;
+    for (auto const& shard : list_shards(path)) {
+        _shards.emplace_back(shard);
+        size += _shards.back().size();
+    }
+
+    if (size < first + required)
+        throw std::runtime_error("file stream " + path + " holds " + std::to_string(size) +
+                                 " bytes, but " + std::to_string(first + required) +
+                                 " bytes are needed");
+
+    // skip to the shard holding the first byte
+    while (_shard != _shards.size() && _offset >= _shards[_shard].size())
+        _offset -= _shards[_shard++].size();
+}
+
+vec_view file_stream::next() {
+    if (_shard == _shards.size())
+        throw std::runtime_error("file stream is exhausted");
+
+    mapped_file const& shard = _shards[_shard];
+    if (_offset + _vector_size <= shard.size()) {
+        std::uint8_t const* data = shard.data() + _offset;
+        _offset += _vector_size;
+        if (_offset == shard.size()) {
+            ++_shard;
+            _offset = 0;
+        }
+        return make_view(data, _vector_size);
+    }
+
+    // the test vector spans more shards
+    for (std::size_t filled = 0; filled != _vector_size;) {
+        if (_shard == _shards.size())
+            throw std::runtime_error("file stream is exhausted");
+
+        mapped_file const& part = _shards[_shard];
+        const std::size_t n =
+                std::size_t(std::min<std::uint64_t>(_vector_size - filled, part.size() - _offset));
+        std::memcpy(_buffer.data() + filled, part.data() + _offset, n);
+        filled += n;
+        _offset += n;
+        if (_offset == part.size()) {
+            ++_shard;
+            _offset = 0;
+        }
+    }
+    std::uint8_t const* data = _buffer.data();
+    return make_view(data, _vector_size);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <eacirc-core/json.h>
+#include <eacirc-streams/stream.h>
+#include <string>
+#include <vector>
+
+/** Read-only memory mapping of a whole file
+ */
+struct mapped_file {
+    mapped_file(std::string const& path);
+
+    mapped_file(mapped_file&& other);
+    mapped_file(mapped_file const&) = delete;
+
+    mapped_file& operator=(mapped_file&&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    ~mapped_file();
+
+    std::uint8_t const* data() const { return _data; }
+    std::uint64_t size() const { return _size; }
+
+private:
+    std::uint8_t const* _data;
+    std::uint64_t _size;
+#ifdef _WIN32
+    void* _mapping;
+#endif
+};
+
+/** Stream replaying data pre-generated into a binary file or a directory of shards.
+ *
+ * Shards of a directory are read in the order of their names, as one contiguous stream. Test
+ * vectors are views into the memory mapped files, they are copied only if they span two shards.
+ * The stream starts at the byte @p first and has to hold at least @p required bytes after it.
+ */
+struct file_stream : stream {
+    file_stream(json const& config, std::size_t osize, std::uint64_t first, std::uint64_t required);
+
+    vec_view next() override;
+
+private:
+    std::vector<mapped_file> _shards;
+    std::size_t _shard;
+    std::uint64_t _offset;
+    std::size_t _vector_size;
+    std::vector<std::uint8_t> _buffer;
+};
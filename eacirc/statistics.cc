@@ -1,5 +1,7 @@
 #include "statistics.h"
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
 
 /** gamma function
  * taken from http://www.crbond.com/math.htm (Gamma function in C/C++ for real
@@ -84,14 +86,15 @@ double gamma0(double x) {
  * taken from http://www.crbond.com/math.htm (Incomplete Gamma function, ported
  * from Zhang and Jin)
  * @param a
+ * @param ga    Gamma(a)
  * @param x
  * @param gin
  * @param gim
  * @param gip
  * @return
  */
-static int incog(double a, double x, double& gin, double& gim, double& gip) {
-    double xam, r, s, ga, t0;
+static int incog(double a, double ga, double x, double& gin, double& gim, double& gip) {
+    double xam, r, s, t0;
     int k;
 
     if ((a < 0.0) || (x < 0))
@@ -101,7 +104,7 @@ static int incog(double a, double x, double& gin, double& gim, double& gip) {
         return 1;
     if (x == 0.0) {
         gin = 0.0;
-        gim = gamma0(a);
+        gim = ga;
         gip = 0.0;
         return 0;
     }
@@ -115,7 +118,6 @@ static int incog(double a, double x, double& gin, double& gim, double& gip) {
                 break;
         }
         gin = std::exp(xam) * s;
-        ga = gamma0(a);
         gip = gin / ga;
         gim = ga - gin;
     } else {
@@ -124,13 +126,90 @@ static int incog(double a, double x, double& gin, double& gim, double& gip) {
             t0 = (k - a) / (1.0 + k / (x + t0));
         }
         gim = std::exp(xam) / (x + t0);
-        ga = gamma0(a);
         gin = ga - gim;
         gip = 1.0 - gim / ga;
     }
     return 0;
 }
 
+namespace {
+
+    /** Values depending only on the degrees of freedom, computed once.
+     *
+     * For dof up to max_closed_form_dof the survival function has a closed form, a finite sum of
+     * (dof - 1) / 2 terms: exp(-x) * sum x^k / k! for even dof and erfc(sqrt(x)) plus
+     * exp(-x) * sum x^(k - 1/2) / Gamma(k + 1/2) for odd dof, where x is half of the statistic.
+     * Larger dofs sum the same terms in logarithms, as they would overflow otherwise.
+     */
+    struct chisqr_tables {
+        static constexpr int max_closed_form_dof = 200;
+        static constexpr int max_tabulated_dof = 340;
+
+        // 1 / k! and 1 / Gamma(k + 3/2) for k = 0, 1, ...
+        double even[max_closed_form_dof / 2];
+        double odd[max_closed_form_dof / 2];
+        // Gamma(dof / 2)
+        double gamma[max_tabulated_dof + 1];
+
+        chisqr_tables() {
+            even[0] = 1.0;
+            odd[0] = 2.0 / std::sqrt(M_PI);
+            for (int k = 1; k != max_closed_form_dof / 2; ++k) {
+                even[k] = even[k - 1] / k;
+                odd[k] = odd[k - 1] / (k + 0.5);
+            }
+            gamma[0] = 1e308;
+            for (int dof = 1; dof <= max_tabulated_dof; ++dof)
+                gamma[dof] = gamma0(dof * 0.5);
+        }
+
+        static chisqr_tables const& get() {
+            static const chisqr_tables tables;
+            return tables;
+        }
+    };
+
+    constexpr int chisqr_tables::max_closed_form_dof;
+    constexpr int chisqr_tables::max_tabulated_dof;
+
+    /** The closed form for any dof, summing the terms relative to the largest one.
+     *
+     * Below the mean, the p-value is close to one and is computed as the complement of the
+     * lower tail instead, whose series converges there.
+     */
+    double chisqr_logarithmic(int dof, double x) {
+        const double a = dof * 0.5;
+        if (x < a) {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; term > sum * 1e-17; ++k)
+                sum += term *= x / (a + k);
+            return 1.0 - std::exp(a * std::log(x) - x - std::lgamma(a + 1) + std::log(sum));
+        }
+
+        const double shift = dof % 2 == 0 ? 0.0 : 0.5;
+        const int terms = dof % 2 == 0 ? dof / 2 : (dof - 1) / 2;
+        if (terms == 0)
+            return std::erfc(std::sqrt(x));
+
+        // term k is x^(k + shift) * exp(-x) / Gamma(k + shift + 1), the ratio of
+        // consecutive terms is x / (k + shift + 1), so the largest one is at k ~ x - shift
+        const int peak = int(std::max(0.0, std::min(double(terms - 1), std::floor(x - shift))));
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = peak; k != 0; --k)
+            sum += term *= (k + shift) / x;
+        term = 1.0;
+        for (int k = peak + 1; k != terms; ++k)
+            sum += term *= x / (k + shift);
+
+        const double log_peak = (peak + shift) * std::log(x) - x - std::lgamma(peak + shift + 1);
+        const double tail = std::exp(log_peak + std::log(sum));
+        return std::min(1.0, shift == 0.0 ? tail : std::erfc(std::sqrt(x)) + tail);
+    }
+
+} // namespace
+
 /** function converting Chi^2 value to corresponding p-value
  * taken from
  * http://www.codeproject.com/Articles/432194/How-to-Calculate-the-Chi-Squared-P-Value
@@ -140,7 +219,7 @@ static int incog(double a, double x, double& gin, double& gim, double& gip) {
  * @param Cv    Chi^2 value
  * @return      p-value
  */
-static double chisqr(int Dof, double Cv) {
+double chisqr_incog(int Dof, double Cv) {
     if (Cv < 0 || Dof < 1) {
         return 1;
     }
@@ -149,36 +228,62 @@ static double chisqr(int Dof, double Cv) {
     if (Dof == 2) {
         return std::exp(-1.0 * X);
     }
+    const double ga =
+            Dof <= chisqr_tables::max_tabulated_dof ? chisqr_tables::get().gamma[Dof] : gamma0(K);
     double gin, gim, gip;
-    incog(K, X, gin, gim, gip); // compute incomplete gamma function
+    if (incog(K, ga, X, gin, gim, gip) != 0) // compute incomplete gamma function
+        return 1;
     double PValue = gim;
-    PValue /= gamma0(K); // divide by gamma function value
+    PValue /= ga; // divide by gamma function value
     return PValue;
 }
 
-double two_sample_chisqr::_compute() const {
+double chisqr(int dof, double value) {
+    if (value < 0 || dof < 1)
+        return 1;
+    const double x = value * 0.5;
+    // exp(-x) underflows beyond
+    if (dof > chisqr_tables::max_closed_form_dof || x > 700.0)
+        return chisqr_logarithmic(dof, x);
+
+    auto const& tables = chisqr_tables::get();
+    const int terms = (dof - 1) / 2;
+    double sum = 0.0;
+    if (dof % 2 == 0) {
+        for (int k = terms; k >= 0; --k)
+            sum = sum * x + tables.even[k];
+        return std::min(1.0, std::exp(-x) * sum);
+    }
+    for (int k = terms - 1; k >= 0; --k)
+        sum = sum * x + tables.odd[k];
+    const double root = std::sqrt(x);
+    return std::min(1.0, std::erfc(root) + std::exp(-x) * root * sum);
+}
+
+chisqr_statistic two_sample_chisqr::statistic(std::vector<std::uint64_t> const& histogram_a,
+                                              std::vector<std::uint64_t> const& histogram_b) {
     // using two-smaple Chi^2 test
     // (http://www.itl.nist.gov/div898/software/dataplot/refman1/auxillar/chi2samp.htm)
 
     double k1 = 1;
     double k2 = 1;
-    double chisqr_value = 0;
-    int dof = 0;
+    chisqr_statistic result;
 
-    for (unsigned i = 0; i != _histogram_a.size(); ++i) {
-        auto sum = _histogram_a[i] + _histogram_b[i];
+    for (unsigned i = 0; i != histogram_a.size(); ++i) {
+        auto sum = histogram_a[i] + histogram_b[i];
         if (sum > 5) {
-            dof++;
-            chisqr_value += std::pow(k1 * _histogram_a[i] - k2 * _histogram_b[i], 2) / sum;
+            result.dof++;
+            result.value += std::pow(k1 * histogram_a[i] - k2 * histogram_b[i], 2) / sum;
         }
     }
-    dof--; // last category is fully determined by others
-
-    return chisqr(dof, chisqr_value);
+    result.dof--; // last category is fully determined by others
+    return result;
 }
 
-#include <algorithm>
-#include <stdexcept>
+double two_sample_chisqr::compute(std::vector<std::uint64_t> const& histogram_a,
+                                  std::vector<std::uint64_t> const& histogram_b) {
+    return statistic(histogram_a, histogram_b).pvalue();
+}
 
 double ks_uniformity_test::_compute_critical_value(std::size_t size, unsigned significance_level) {
     if (size <= 35)
@@ -211,3 +316,63 @@ double ks_uniformity_test::_compute_uniformity_test(std::vector<double>& samples
     }
     return test_statistic;
 }
+
+constexpr std::size_t sequential_ks_test::min_size;
+
+sequential_ks_test::sequential_ks_test(std::size_t max_size, unsigned significance_level)
+    : _max_size(max_size)
+    , _significance_level(significance_level)
+    , _alpha(significance_level / 100.0 /
+             double(std::max<std::size_t>(1, max_size - std::min(max_size, min_size)))) {
+    if (max_size < min_size)
+        throw std::runtime_error("Too few samples for sequential KS test (<=35).");
+    // throws on the levels the regular test has no critical values for
+    ks_uniformity_test::_compute_critical_value(max_size, significance_level);
+}
+
+sequential_ks_test::decision sequential_ks_test::look(std::vector<double> const& samples) {
+    if (samples.size() > _max_size)
+        throw std::out_of_range("Too many samples for the sequential KS test.");
+
+    for (std::size_t i = _sorted.size(); i != samples.size(); ++i)
+        _sorted.insert(std::upper_bound(_sorted.begin(), _sorted.end(), samples[i]), samples[i]);
+    if (_sorted.size() < min_size)
+        return decision::undecided;
+    if (_sorted.front() < 0 || _sorted.back() > 1)
+        throw std::out_of_range("Cannot run K-S test, data out of range.");
+
+    if (_statistic(0, 0) > _critical_value(_sorted.size()))
+        return decision::rejected;
+
+    // the statistic of a later look is the largest when all the samples until then are zeros
+    // or all of them are ones; the last looks are the most likely to reject, so they go first
+    for (std::size_t size = _max_size; size > _sorted.size(); --size) {
+        const std::size_t added = size - _sorted.size();
+        const double critical = _critical_value(size);
+        if (_statistic(added, 0) > critical || _statistic(0, added) > critical)
+            return decision::undecided;
+    }
+    return decision::accepted;
+}
+
+double sequential_ks_test::_critical_value(std::size_t size) const {
+    const double regular = ks_uniformity_test::_compute_critical_value(size, _significance_level);
+    if (size == _max_size)
+        return regular;
+
+    // asymptotic Kolmogorov distribution, it gives the tabulated 1.628 for 1% and so on
+    const double look = std::sqrt(-0.5 * std::log(_alpha / 2)) / std::sqrt(double(size));
+    return std::max(regular, look);
+}
+
+double sequential_ks_test::_statistic(std::size_t zeros, std::size_t ones) const {
+    const double n = double(zeros + _sorted.size() + ones);
+    double test_statistic = std::max(zeros / n, ones / n);
+
+    for (std::size_t i = 0; i != _sorted.size(); ++i) {
+        const double rank = double(zeros + i);
+        const double temp = std::max(_sorted[i] - rank / n, (rank + 1) / n - _sorted[i]);
+        test_statistic = std::max(test_statistic, temp);
+    }
+    return test_statistic;
+}
@@ -1,32 +1,72 @@
 #pragma once
 
+#include "circuit/histogram.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <vector>
 
+/** p-value of the Chi^2 statistic @p value with @p dof degrees of freedom.
+ *
+ * Small dofs are evaluated by closed forms with precomputed coefficients, which agree with
+ * chisqr_incog to about 1e-13 relatively, larger ones fall back to chisqr_incog.
+ */
+double chisqr(int dof, double value);
+
+/** p-value of the Chi^2 statistic by the series of the incomplete gamma function
+ */
+double chisqr_incog(int dof, double value);
+
+/** Chi^2 statistic with its degrees of freedom.
+ *
+ * The p-value decreases with the value, so statistics with the same dof can be compared
+ * without computing their p-values.
+ */
+struct chisqr_statistic {
+    double value{0.0};
+    int dof{0};
+
+    double pvalue() const { return chisqr(dof, value); }
+};
+
 struct two_sample_chisqr {
     two_sample_chisqr(std::size_t categories)
         : _histogram_a(categories)
         , _histogram_b(categories) {}
 
+    /** p-value of the test of bytes of vectors of two containers, the vectors are contiguous
+     */
     template <typename Container> double operator()(Container const& a, Container const& b) {
-        std::fill(_histogram_a.begin(), _histogram_a.end(), 0u);
-        std::fill(_histogram_b.begin(), _histogram_b.end(), 0u);
-
-        for (auto vec : a)
-            for (std::uint8_t byte : vec)
-                _histogram_a[byte % _histogram_a.size()]++;
-        for (auto vec : b)
-            for (std::uint8_t byte : vec)
-                _histogram_b[byte % _histogram_b.size()]++;
-        return _compute();
+        _fill(a, _histogram_a);
+        _fill(b, _histogram_b);
+        return compute(_histogram_a, _histogram_b);
     }
 
+    std::size_t categories() const { return _histogram_a.size(); }
+
+    /** Statistic of the test of two already filled histograms of the same size
+     */
+    static chisqr_statistic statistic(std::vector<std::uint64_t> const& histogram_a,
+                                      std::vector<std::uint64_t> const& histogram_b);
+
+    /** p-value of the test of two already filled histograms of the same size
+     */
+    static double compute(std::vector<std::uint64_t> const& histogram_a,
+                          std::vector<std::uint64_t> const& histogram_b);
+
 private:
     std::vector<std::uint64_t> _histogram_a;
     std::vector<std::uint64_t> _histogram_b;
+    circuit::byte_counts _counts;
 
-    double _compute() const;
+    template <typename Container>
+    void _fill(Container const& vectors, std::vector<std::uint64_t>& histogram) {
+        _counts.clear();
+        for (auto vec : vectors)
+            _counts.add(&*vec.begin(), vec.size());
+        std::fill(histogram.begin(), histogram.end(), 0u);
+        _counts.fold(histogram);
+    }
 };
 
 struct ks_uniformity_test {
@@ -38,6 +78,43 @@ struct ks_uniformity_test {
     const double test_statistic;
 
 private:
+    friend struct sequential_ks_test;
+
     static double _compute_critical_value(std::size_t size, unsigned significance_level);
     static double _compute_uniformity_test(std::vector<double>& samples);
 };
+
+/** KS uniformity test repeated after each new sample, to stop sampling as soon as the outcome
+ * of the regular KS test is certain.
+ *
+ * Samples are looked at from the smallest size the KS critical values are valid for up to
+ * @p max_size. The last look is the regular ks_uniformity_test. The earlier ones reject
+ * uniformity at the significance level divided by their number, so the probability of a false
+ * early rejection stays within the level; their critical values are never below the regular
+ * ones, so the regular test rejects the samples of an early rejection too. The test accepts
+ * uniformity as soon as no later look could reject, whatever the remaining samples are.
+ *
+ * The outcome to report is the one of ks_uniformity_test over the samples looked at.
+ */
+struct sequential_ks_test {
+    enum class decision { undecided, rejected, accepted };
+
+    sequential_ks_test(std::size_t max_size, unsigned significance_level);
+
+    /** Decides on @p samples, all samples of the previous looks and the new ones
+     */
+    decision look(std::vector<double> const& samples);
+
+    std::size_t max_size() const { return _max_size; }
+
+private:
+    static constexpr std::size_t min_size = 36;
+
+    const std::size_t _max_size;
+    const unsigned _significance_level;
+    const double _alpha; // of a single look before the last one
+    std::vector<double> _sorted;
+
+    double _critical_value(std::size_t size) const;
+    double _statistic(std::size_t zeros, std::size_t ones) const;
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "individual.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <eacirc-core/dataset.h>
+#include <eacirc-core/random.h>
+#include <eacirc-core/view.h>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+namespace solvers {
+
+    /** Steady-state genetic algorithm: every generation, the offspring replace the worst
+     * individuals of the population, while the elite ones always survive.
+     *
+     * Parents are chosen by tournaments, crossed over and the child is mutated. All offspring
+     * of a generation are made by the calling thread from a single random generator and then
+     * evaluated in parallel, each thread scoring a contiguous part of them by its own copy of
+     * the evaluator at once. So the search is the same for any number of threads.
+     *
+     * The population is kept sorted from the best individual, which is the solution tested on
+     * new datasets.
+     */
+    template <typename Genotype,
+              typename Initializer,
+              typename Mutator,
+              typename Crossover,
+              typename Evaluator,
+              typename Generator = default_random_generator>
+    struct genetic_algorithm {
+        /** Zero @p threads stands for the number of hardware threads, threads beyond the number
+         * of offspring would be idle and are not started.
+         */
+        template <typename Sseq>
+        genetic_algorithm(Genotype&& gen,
+                          Initializer&& ini,
+                          Mutator&& mut,
+                          Crossover&& cro,
+                          Evaluator&& eva,
+                          Sseq&& seed,
+                          std::size_t population_size,
+                          std::size_t offspring,
+                          std::size_t elite = 1,
+                          std::size_t tournament_size = 2,
+                          unsigned threads = 1)
+            : _initializer(std::move(ini))
+            , _mutator(std::move(mut))
+            , _crossover(std::move(cro))
+            , _generator(std::forward<Sseq>(seed))
+            , _offspring(offspring)
+            , _tournament_size(tournament_size)
+            , _pool(_num_of_threads(population_size, offspring, elite, tournament_size, threads))
+            , _num_of_evaluations(0) {
+            _population.reserve(population_size);
+            for (std::size_t i = 0; i != population_size; ++i) {
+                _population.emplace_back(Genotype(gen));
+                _initializer.apply(_population.back().genotype, _generator);
+            }
+            _evaluators.assign(_pool.size(), std::move(eva));
+        }
+
+        double run(std::uint64_t generations) {
+            for (std::uint64_t i = 0; i != generations; ++i)
+                _step();
+            return _population.front().score;
+        }
+
+        /** Changes the datasets of the evaluators, which may keep just references to them.
+         *
+         * The whole population is scored on the new datasets. The returned score is the one of
+         * the best individual on the previous datasets, so that it is not selected on the new
+         * ones.
+         */
+        template <typename Dataset> double reevaluate(Dataset const& a, Dataset const& b) {
+            for (auto& eva : _evaluators)
+                eva.change_datasets(a, b);
+
+            _genotypes.clear();
+            for (auto const& ind : _population)
+                _genotypes.emplace_back(ind.genotype);
+            _evaluate(_genotypes);
+            for (std::size_t i = 0; i != _population.size(); ++i)
+                _population[i].score = _genotype_scores[i];
+
+            const double score = _population.front().score;
+            _sort();
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Evaluates the best individual over datasets given chunk by chunk between
+         * begin_reevaluation and end_reevaluation, which returns the same score as reevaluate
+         * would
+         */
+        void begin_reevaluation() {
+            _evaluators.front().begin_chunks(_population.front().genotype);
+        }
+
+        template <typename Dataset> void reevaluate_chunk(Dataset const& a, Dataset const& b) {
+            _evaluators.front().add_chunks(a, b);
+        }
+
+        double end_reevaluation() {
+            const double score = _evaluators.front().finish_chunks();
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Score of the best individual after every generation and reevaluation
+         */
+        auto scores() const -> view<std::vector<double>::const_iterator> {
+            return make_view(_scores);
+        }
+
+        auto population() const
+                -> view<typename std::vector<individual<Genotype, double>>::const_iterator> {
+            return make_view(_population);
+        }
+
+        Evaluator const& evaluator() const { return _evaluators.front(); }
+
+        std::uint64_t num_of_evaluations() const { return _num_of_evaluations; }
+
+    private:
+        Initializer _initializer;
+        Mutator _mutator;
+        Crossover _crossover;
+        Generator _generator;
+        const std::size_t _offspring;
+        const std::size_t _tournament_size;
+
+        thread_pool _pool;
+        std::vector<Evaluator> _evaluators; // one per thread
+
+        std::vector<individual<Genotype, double>> _population;
+        std::vector<Genotype> _genotypes; // the offspring, or the population to be rescored
+        std::vector<double> _genotype_scores;
+
+        std::vector<double> _scores;
+        std::uint64_t _num_of_evaluations;
+
+        static unsigned _num_of_threads(std::size_t population_size,
+                                        std::size_t offspring,
+                                        std::size_t elite,
+                                        std::size_t tournament_size,
+                                        unsigned threads) {
+            if (elite == 0 || elite >= population_size)
+                throw std::runtime_error("the elite has to be a nonempty part of the population");
+            if (offspring == 0 || offspring > population_size - elite)
+                throw std::runtime_error("the offspring can replace only individuals out of elite");
+            if (tournament_size == 0)
+                throw std::runtime_error("the tournament size can't be zero");
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::min<std::size_t>(threads, offspring));
+        }
+
+        // the population is sorted, so the winner of a tournament is the lowest index drawn
+        individual<Genotype, double> const& _select() {
+            std::uniform_int_distribution<std::size_t> index{0, _population.size() - 1};
+            std::size_t winner = index(_generator);
+            for (std::size_t i = 1; i != _tournament_size; ++i)
+                winner = std::min(winner, index(_generator));
+            return _population[winner];
+        }
+
+        // the best first, equal individuals keep their order
+        void _sort() {
+            std::stable_sort(_population.begin(),
+                             _population.end(),
+                             std::greater<individual<Genotype, double>>());
+        }
+
+        // scores the genotypes in parallel, each thread evaluating a contiguous part of them
+        void _evaluate(std::vector<Genotype> const& genotypes) {
+            const std::size_t n = genotypes.size();
+            _genotype_scores.resize(n);
+            _pool.run([&](unsigned t) {
+                const std::size_t first = n * t / _pool.size();
+                const std::size_t last = n * (t + 1) / _pool.size();
+                _evaluators[t].apply(genotypes.begin() + first,
+                                     genotypes.begin() + last,
+                                     _genotype_scores.begin() + first);
+            });
+        }
+
+        void _step() {
+            _genotypes.resize(_offspring, _population.front().genotype);
+            for (auto& child : _genotypes) {
+                auto const& a = _select();
+                auto const& b = _select();
+                _crossover.apply(a.genotype, b.genotype, child, _generator);
+                _mutator.apply(child, _generator);
+            }
+            _evaluate(_genotypes);
+            _num_of_evaluations += _offspring;
+
+            // the offspring replace the worst individuals, the elite is never among them
+            const std::size_t first = _population.size() - _offspring;
+            for (std::size_t i = 0; i != _offspring; ++i) {
+                _population[first + i].genotype = _genotypes[i];
+                _population[first + i].score = _genotype_scores[i];
+            }
+            _sort();
+            _scores.emplace_back(_population.front().score);
+        }
+    };
+
+} // namespace solvers
@@ -42,7 +42,7 @@ namespace solvers {
         friend void swap(individual& lhs, individual& rhs) {
             using std::swap;
             swap(lhs.genotype, rhs.genotype);
-            swap(lhs.score, lhs.score);
+            swap(lhs.score, rhs.score);
         }
     };
 
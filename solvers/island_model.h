@@ -0,0 +1,203 @@
+#pragma once
+
+#include "individual.h"
+#include "local_search.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <eacirc-core/memory.h>
+#include <eacirc-core/random.h>
+#include <eacirc-core/view.h>
+#include <memory>
+#include <stdexcept>
+
+namespace solvers {
+
+    /** Independent local searches (islands) run in parallel, exchanging their solutions every
+     * few generations.
+     *
+     * Every island draws from its own random generator split from the seed. After every
+     * @p migration_interval generations, each island publishes its solution into its own slot
+     * and then takes the one of the previous island in a ring, if it is better than its own.
+     * A slot has a single writer and is read only after all islands have written theirs, so the
+     * exchange needs no locks and the search is the same for any number of threads.
+     *
+     * All islands evaluate circuits over the same datasets, which are only referenced.
+     */
+    template <typename Genotype,
+              typename Initializer,
+              typename Mutator,
+              typename Evaluator,
+              typename Generator = default_random_generator>
+    struct island_model {
+        using search = local_search<Genotype, Initializer, Mutator, Evaluator, Generator>;
+
+        /** Zero @p threads stands for the number of hardware threads, threads beyond the number
+         * of islands would be idle and are not started. Each island runs a local search with
+         * @p neighbours per generation on a single thread.
+         */
+        template <typename Sseq>
+        island_model(Genotype&& gen,
+                     Initializer&& ini,
+                     Mutator&& mut,
+                     Evaluator&& eva,
+                     Sseq&& seed,
+                     std::size_t islands,
+                     std::uint64_t migration_interval,
+                     std::size_t neighbours = 1,
+                     unsigned threads = 1,
+                     bool undo = false)
+            : _pool(_num_of_threads(islands, migration_interval, threads))
+            , _migration_interval(migration_interval)
+            , _generation(0)
+            , _migrations(islands, 0u)
+            , _champion(0) {
+            Generator generator(std::forward<Sseq>(seed));
+            seed_seq_from<Generator> splitter(generator());
+            for (std::size_t i = 0; i != islands; ++i)
+                _islands.emplace_back(std::make_unique<search>(Genotype(gen),
+                                                               Initializer(ini),
+                                                               Mutator(mut),
+                                                               Evaluator(eva),
+                                                               splitter,
+                                                               neighbours,
+                                                               1u,
+                                                               undo));
+            for (auto const& island : _islands)
+                _emigrants.emplace_back(island->solution());
+        }
+
+        /** Runs @p generations on every island, migrating after each multiple of the migration
+         * interval
+         */
+        double run(std::uint64_t generations) {
+            while (generations != 0) {
+                const std::uint64_t n = std::min(
+                        generations, _migration_interval - _generation % _migration_interval);
+                _generation += n;
+                generations -= n;
+                const bool migrating = _generation % _migration_interval == 0;
+
+                _pool.run_each(_islands.size(), [&](std::size_t i) {
+                    _islands[i]->run(n);
+                    if (migrating)
+                        _emigrants[i] = _islands[i]->solution();
+                });
+                if (migrating)
+                    _migrate();
+                _scores.emplace_back(_islands[_best()]->solution().score);
+            }
+            return _scores.back();
+        }
+
+        /** Changes the datasets of all islands.
+         *
+         * The returned score is the one of the solution of the island best on the previous
+         * datasets, so that it is not selected on the new ones.
+         */
+        template <typename Dataset> double reevaluate(Dataset const& a, Dataset const& b) {
+            _champion = _best();
+            _pool.run_each(_islands.size(), [&](std::size_t i) { _islands[i]->reevaluate(a, b); });
+
+            const double score = _islands[_champion]->solution().score;
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Evaluates the solution of the best island over datasets given chunk by chunk between
+         * begin_reevaluation and end_reevaluation, which returns the same score as reevaluate
+         * would
+         */
+        void begin_reevaluation() {
+            _champion = _best();
+            _islands[_champion]->begin_reevaluation();
+        }
+
+        template <typename Dataset> void reevaluate_chunk(Dataset const& a, Dataset const& b) {
+            _islands[_champion]->reevaluate_chunk(a, b);
+        }
+
+        double end_reevaluation() {
+            const double score = _islands[_champion]->end_reevaluation();
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Score of the best solution after every migration interval and reevaluation
+         */
+        auto scores() const -> view<std::vector<double>::const_iterator> {
+            return make_view(_scores);
+        }
+
+        /** The evaluator of the first island
+         */
+        Evaluator const& evaluator() const { return _islands.front()->evaluator(); }
+
+        std::size_t num_of_islands() const { return _islands.size(); }
+
+        search const& island(std::size_t i) const { return *_islands[i]; }
+
+        std::uint64_t num_of_evaluations() const {
+            std::uint64_t sum = 0;
+            for (auto const& island : _islands)
+                sum += island->num_of_evaluations();
+            return sum;
+        }
+
+        std::uint64_t num_of_skipped_evaluations() const {
+            std::uint64_t sum = 0;
+            for (auto const& island : _islands)
+                sum += island->num_of_skipped_evaluations();
+            return sum;
+        }
+
+        /** Number of migrants which replaced the solution of their destination island
+         */
+        std::uint64_t num_of_migrations() const {
+            std::uint64_t sum = 0;
+            for (auto n : _migrations)
+                sum += n;
+            return sum;
+        }
+
+    private:
+        thread_pool _pool;
+        std::vector<std::unique_ptr<search>> _islands;
+        const std::uint64_t _migration_interval;
+        std::uint64_t _generation;
+
+        std::vector<individual<Genotype, double>> _emigrants; // written only by their island
+        std::vector<std::uint64_t> _migrations;               // per destination island
+        std::size_t _champion;
+
+        std::vector<double> _scores;
+
+        static unsigned
+        _num_of_threads(std::size_t islands, std::uint64_t migration_interval, unsigned threads) {
+            if (islands == 0)
+                throw std::runtime_error("the number of islands can't be zero");
+            if (migration_interval == 0)
+                throw std::runtime_error("the migration interval can't be zero");
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::min<std::size_t>(threads, islands));
+        }
+
+        // the first of the islands with the best solution
+        std::size_t _best() const {
+            std::size_t best = 0;
+            for (std::size_t i = 1; i != _islands.size(); ++i)
+                if (_islands[best]->solution() < _islands[i]->solution())
+                    best = i;
+            return best;
+        }
+
+        void _migrate() {
+            const std::size_t k = _islands.size();
+            _pool.run_each(k, [&](std::size_t i) {
+                if (_islands[i]->immigrate(_emigrants[(i + k - 1) % k]))
+                    ++_migrations[i];
+            });
+        }
+    };
+
+} // namespace solvers
@@ -1,47 +1,168 @@
 #pragma once
 
 #include "individual.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
 #include <eacirc-core/dataset.h>
 #include <eacirc-core/random.h>
 #include <eacirc-core/view.h>
+#include <limits>
+#include <random>
+#include <stdexcept>
 
 namespace solvers {
 
+    /** (1 + lambda) local search: every generation, the best of the mutants of the solution
+     * replaces it, unless it is worse.
+     *
+     * With more than one neighbour per generation, the neighbours are mutated and evaluated in
+     * parallel, each thread owning a copy of the evaluator. Every neighbour draws from its own
+     * random generator split from the seed, so the search is the same for any number of threads.
+     *
+     * At a positive temperature, a worse neighbour is accepted as well, with the probability
+     * exp((neighbour score - solution score) / temperature). Neighbours which the evaluator
+     * rejects without scoring them exactly are never accepted then.
+     */
     template <typename Genotype,
               typename Initializer,
               typename Mutator,
               typename Evaluator,
               typename Generator = default_random_generator>
     struct local_search {
+        /** Zero @p threads stands for the number of hardware threads, threads beyond the number
+         * of neighbours would be idle and are not started. With @p undo, a single neighbour is
+         * made by mutating the solution in place, and the mutation is rolled back if rejected.
+         */
         template <typename Sseq>
-        local_search(Genotype&& gen, Initializer&& ini, Mutator&& mut, Evaluator&& eva, Sseq&& seed)
+        local_search(Genotype&& gen,
+                     Initializer&& ini,
+                     Mutator&& mut,
+                     Evaluator&& eva,
+                     Sseq&& seed,
+                     std::size_t neighbours = 1,
+                     unsigned threads = 1,
+                     bool undo = false)
             : _solution(std::move(gen))
             , _neighbour(_solution)
             , _initializer(std::move(ini))
             , _mutator(std::move(mut))
             , _evaluator(std::move(eva))
-            , _generator(std::forward<Sseq>(seed)) {
+            , _generator(std::forward<Sseq>(seed))
+            , _pool(_num_of_threads(neighbours, threads))
+            , _sync(false)
+            , _winner(0)
+            , _num_of_evaluations(0)
+            , _num_of_skipped_evaluations(0)
+            , _num_of_accepted(0)
+            , _temperature(0.0) {
             _initializer.apply(_solution.genotype, _generator);
+            _changes.keep_undo_log(undo && neighbours == 1);
+
+            if (neighbours > 1) {
+                seed_seq_from<Generator> splitter(_generator());
+                for (std::size_t i = 0; i != neighbours; ++i)
+                    _neighbours.emplace_back(_solution, splitter);
+                _helpers.assign(_pool.size() - 1, _evaluator);
+                _last.resize(_pool.size());
+            }
         }
 
         double run(std::uint64_t generations) {
-            for (std::uint64_t i = 0; i != generations; ++i)
-                _step();
+            for (std::uint64_t i = 0; i != generations; ++i) {
+                if (!_neighbours.empty())
+                    _step_neighbours();
+                else if (_changes.keeps_undo_log())
+                    _step_in_place();
+                else
+                    _step();
+            }
             return _solution.score;
         }
 
-        double reevaluate(dataset const& a, dataset const& b) {
-            _evaluator.change_datasets(a, b);
-            _solution.score = _evaluator.apply(_solution.genotype);
+        /** Changes the datasets of the evaluator, which may keep just references to them
+         */
+        template <typename Dataset> double reevaluate(Dataset const& a, Dataset const& b) {
+            _pool.run([&](unsigned i) {
+                Evaluator& eva = _evaluator_of(i);
+                eva.change_datasets(a, b);
+                if (i == 0)
+                    _solution.score = eva.apply(_solution.genotype);
+                else
+                    eva.apply(_solution.genotype);
+            });
+            _sync = false;
             _scores.emplace_back(_solution.score);
             return _solution.score;
         }
 
+        /** Evaluates the solution over datasets given chunk by chunk between begin_reevaluation
+         * and end_reevaluation, which returns the same score as reevaluate would
+         */
+        void begin_reevaluation() { _evaluator.begin_chunks(_solution.genotype); }
+
+        template <typename Dataset> void reevaluate_chunk(Dataset const& a, Dataset const& b) {
+            _evaluator.add_chunks(a, b);
+        }
+
+        double end_reevaluation() {
+            const double score = _evaluator.finish_chunks();
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Replaces the solution by @p migrant of another search over the same datasets, if the
+         * migrant is better
+         */
+        bool immigrate(individual<Genotype, double> const& migrant) {
+            if (!(_solution < migrant))
+                return false;
+            _solution = migrant;
+            _pool.run([this](unsigned i) { _evaluator_of(i).apply(_solution.genotype); });
+            _sync = false;
+            return true;
+        }
+
+        individual<Genotype, double> const& solution() const { return _solution; }
+
+        double temperature() const { return _temperature; }
+
+        void set_temperature(double temperature) { _temperature = temperature; }
+
         auto scores() const -> view<std::vector<double>::const_iterator> {
             return make_view(_scores);
         }
 
+        Evaluator const& evaluator() const { return _evaluator; }
+
+        std::uint64_t num_of_evaluations() const { return _num_of_evaluations; }
+
+        /** Number of neighbours accepted without evaluation, as their mutation was neutral
+         */
+        std::uint64_t num_of_skipped_evaluations() const { return _num_of_skipped_evaluations; }
+
+        /** Number of evaluated neighbours which got accepted
+         */
+        std::uint64_t num_of_accepted() const { return _num_of_accepted; }
+
     private:
+        using record = typename Mutator::template record<Genotype>;
+
+        static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+        struct neighbour {
+            template <typename Sseq>
+            neighbour(individual<Genotype, double> const& solution, Sseq& seed)
+                : ind(solution)
+                , generator(seed)
+                , evaluated(false) {}
+
+            individual<Genotype, double> ind;
+            Generator generator;
+            record changes;
+            bool evaluated;
+        };
+
         individual<Genotype, double> _solution;
         individual<Genotype, double> _neighbour;
 
@@ -50,15 +171,135 @@ namespace solvers {
         Evaluator _evaluator;
         Generator _generator;
 
+        record _changes;
+
+        thread_pool _pool;
+        std::vector<neighbour> _neighbours;
+        std::vector<Evaluator> _helpers;   // evaluators of the threads other than the first one
+        std::vector<std::size_t> _last;    // the last neighbour evaluated by each thread
+        record _accepted;                  // the mutation of the last accepted neighbour
+        bool _sync;                        // whether the evaluators have to accept it yet
+        std::size_t _winner;
+
         std::vector<double> _scores;
+        std::uint64_t _num_of_evaluations;
+        std::uint64_t _num_of_skipped_evaluations;
+        std::uint64_t _num_of_accepted;
+        double _temperature;
+
+        // whether to move to a neighbour scoring @p score, the coin is tossed only if it is worse
+        bool _accepts(double score) {
+            if (_solution.score <= score)
+                return true;
+            if (_temperature <= 0.0)
+                return false;
+            std::uniform_real_distribution<double> coin;
+            return coin(_generator) < std::exp((score - _solution.score) / _temperature);
+        }
 
         void _step() {
             _neighbour = _solution;
-            _mutator.apply(_neighbour.genotype, _generator);
+            _mutator.apply(_neighbour.genotype, _generator, _changes);
 
-            _neighbour.score = _evaluator.apply(_neighbour.genotype);
-            if (_solution <= _neighbour) {
+            // neutral neighbour scores the same as the solution and is thus always accepted
+            if (_changes.neutral()) {
                 _solution = std::move(_neighbour);
+                _scores.emplace_back(_solution.score);
+                ++_num_of_skipped_evaluations;
+                return;
+            }
+
+            // the evaluator recomputes only the part of the solution changed by the mutation
+            _neighbour.score = _evaluator.apply(_neighbour.genotype, _changes);
+            ++_num_of_evaluations;
+            if (_accepts(_neighbour.score)) {
+                _solution = std::move(_neighbour);
+                ++_num_of_accepted;
+                _evaluator.accept();
+            }
+            _scores.emplace_back(_solution.score);
+        }
+
+        // the same as _step, but the solution is mutated instead of its copy
+        void _step_in_place() {
+            _mutator.apply(_solution.genotype, _generator, _changes);
+
+            if (_changes.neutral()) {
+                _scores.emplace_back(_solution.score);
+                ++_num_of_skipped_evaluations;
+                return;
+            }
+
+            const double score = _evaluator.apply(_solution.genotype, _changes);
+            ++_num_of_evaluations;
+            if (_accepts(score)) {
+                _solution.score = score;
+                ++_num_of_accepted;
+                _evaluator.accept();
+            } else {
+                _changes.rollback(_solution.genotype);
+            }
+            _scores.emplace_back(_solution.score);
+        }
+
+        static unsigned _num_of_threads(std::size_t neighbours, unsigned threads) {
+            if (neighbours == 0)
+                throw std::runtime_error("the number of neighbours per generation can't be zero");
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::min<std::size_t>(threads, neighbours));
+        }
+
+        Evaluator& _evaluator_of(unsigned thread) {
+            return thread == 0 ? _evaluator : _helpers[thread - 1];
+        }
+
+        void _step_neighbours() {
+            _pool.run([this](unsigned t) {
+                Evaluator& eva = _evaluator_of(t);
+
+                // bring the evaluator to the solution accepted in the previous generation
+                if (_sync) {
+                    if (_last[t] != _winner)
+                        eva.apply(_solution.genotype, _accepted);
+                    eva.accept();
+                }
+                _last[t] = none;
+
+                for (std::size_t i = t; i < _neighbours.size(); i += _pool.size()) {
+                    neighbour& n = _neighbours[i];
+                    n.ind = _solution;
+                    _mutator.apply(n.ind.genotype, n.generator, n.changes);
+
+                    n.evaluated = !n.changes.neutral();
+                    if (n.evaluated) {
+                        n.ind.score = eva.apply(n.ind.genotype, n.changes);
+                        _last[t] = i;
+                    }
+                }
+            });
+
+            // the first of the best neighbours wins, whichever thread evaluated it
+            std::size_t best = 0;
+            for (std::size_t i = 0; i != _neighbours.size(); ++i) {
+                if (_neighbours[i].evaluated)
+                    ++_num_of_evaluations;
+                else
+                    ++_num_of_skipped_evaluations;
+                if (_neighbours[best].ind < _neighbours[i].ind)
+                    best = i;
+            }
+
+            neighbour& n = _neighbours[best];
+            _sync = false;
+            if (_accepts(n.ind.score)) {
+                _solution = std::move(n.ind);
+                if (n.evaluated) {
+                    ++_num_of_accepted;
+                    _accepted = n.changes;
+                    _winner = best;
+                    _sync = true;
+                }
             }
             _scores.emplace_back(_solution.score);
         }
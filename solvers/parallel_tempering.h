@@ -0,0 +1,251 @@
+#pragma once
+
+#include "individual.h"
+#include "local_search.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <eacirc-core/memory.h>
+#include <eacirc-core/random.h>
+#include <eacirc-core/view.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+namespace solvers {
+
+    /** Replica exchange: local searches at a ladder of temperatures run in parallel and
+     * exchange their temperatures every few generations.
+     *
+     * Hot replicas accept worse neighbours often and so move across plateaus, while the cold
+     * ones refine their solutions. After every @p exchange_interval generations, replicas at
+     * neighbouring temperatures swap them with the Metropolis probability
+     * exp((1 / t_cold - 1 / t_hot) * (score_hot - score_cold)), alternating between the even
+     * and the odd pairs. Swapping temperatures instead of solutions keeps the evaluators of the
+     * replicas in place.
+     *
+     * Every replica draws from its own random generator split from the seed and the exchanges
+     * are decided by the calling thread, so the search is the same for any number of threads.
+     *
+     * Replicas at a positive temperature have to score worse neighbours exactly to accept them,
+     * so an evaluator which rejects circuits without an exact score is refused then.
+     */
+    template <typename Genotype,
+              typename Initializer,
+              typename Mutator,
+              typename Evaluator,
+              typename Generator = default_random_generator>
+    struct parallel_tempering {
+        using search = local_search<Genotype, Initializer, Mutator, Evaluator, Generator>;
+
+        /** One replica runs at each of the ascending @p temperatures, the first may be zero.
+         * Zero @p threads stands for the number of hardware threads, threads beyond the number
+         * of replicas would be idle and are not started.
+         */
+        template <typename Sseq>
+        parallel_tempering(Genotype&& gen,
+                           Initializer&& ini,
+                           Mutator&& mut,
+                           Evaluator&& eva,
+                           Sseq&& seed,
+                           std::vector<double> temperatures,
+                           std::uint64_t exchange_interval,
+                           unsigned threads = 1,
+                           bool undo = false)
+            : _generator(std::forward<Sseq>(seed))
+            , _temperatures(std::move(temperatures))
+            , _pool(_num_of_threads(_temperatures, exchange_interval, threads))
+            , _exchange_interval(exchange_interval)
+            , _generation(0)
+            , _num_of_exchange_rounds(0)
+            , _levels(_temperatures.size())
+            , _champion(0) {
+            if (_temperatures.back() > 0.0 && !eva.scores_exactly())
+                throw std::runtime_error("parallel tempering at positive temperatures needs exact "
+                                         "scores, comparing statistics and racing can't be used");
+
+            seed_seq_from<Generator> splitter(_generator());
+            for (std::size_t i = 0; i != _temperatures.size(); ++i) {
+                _replicas.emplace_back(std::make_unique<search>(Genotype(gen),
+                                                                Initializer(ini),
+                                                                Mutator(mut),
+                                                                Evaluator(eva),
+                                                                splitter,
+                                                                1,
+                                                                1u,
+                                                                undo));
+                _replicas.back()->set_temperature(_temperatures[i]);
+                _replica_at.emplace_back(i);
+            }
+        }
+
+        /** Counters of a temperature, whichever replicas ran at it
+         */
+        struct level {
+            std::uint64_t evaluated{0};
+            std::uint64_t accepted{0};
+            // exchanges with the next hotter temperature
+            std::uint64_t exchanges_tried{0};
+            std::uint64_t exchanges_accepted{0};
+        };
+
+        /** Runs @p generations on every replica, exchanging temperatures after each multiple of
+         * the exchange interval
+         */
+        double run(std::uint64_t generations) {
+            while (generations != 0) {
+                const std::uint64_t n = std::min(
+                        generations, _exchange_interval - _generation % _exchange_interval);
+                _generation += n;
+                generations -= n;
+
+                // each level is updated only by the replica running at it
+                _pool.run_each(_levels.size(), [&](std::size_t l) {
+                    search& replica = *_replicas[_replica_at[l]];
+                    const std::uint64_t evaluated = replica.num_of_evaluations();
+                    const std::uint64_t accepted = replica.num_of_accepted();
+                    replica.run(n);
+                    _levels[l].evaluated += replica.num_of_evaluations() - evaluated;
+                    _levels[l].accepted += replica.num_of_accepted() - accepted;
+                });
+                if (_generation % _exchange_interval == 0)
+                    _exchange();
+                _scores.emplace_back(_replicas[_best()]->solution().score);
+            }
+            return _scores.back();
+        }
+
+        /** Changes the datasets of all replicas.
+         *
+         * The returned score is the one of the solution of the replica best on the previous
+         * datasets, so that it is not selected on the new ones.
+         */
+        template <typename Dataset> double reevaluate(Dataset const& a, Dataset const& b) {
+            _champion = _best();
+            _pool.run_each(_replicas.size(),
+                           [&](std::size_t i) { _replicas[i]->reevaluate(a, b); });
+
+            const double score = _replicas[_champion]->solution().score;
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Evaluates the solution of the best replica over datasets given chunk by chunk
+         * between begin_reevaluation and end_reevaluation, which returns the same score as
+         * reevaluate would
+         */
+        void begin_reevaluation() {
+            _champion = _best();
+            _replicas[_champion]->begin_reevaluation();
+        }
+
+        template <typename Dataset> void reevaluate_chunk(Dataset const& a, Dataset const& b) {
+            _replicas[_champion]->reevaluate_chunk(a, b);
+        }
+
+        double end_reevaluation() {
+            const double score = _replicas[_champion]->end_reevaluation();
+            _scores.emplace_back(score);
+            return score;
+        }
+
+        /** Score of the best solution after every exchange interval and reevaluation
+         */
+        auto scores() const -> view<std::vector<double>::const_iterator> {
+            return make_view(_scores);
+        }
+
+        /** The evaluator of the replica which started at the first temperature
+         */
+        Evaluator const& evaluator() const { return _replicas.front()->evaluator(); }
+
+        std::vector<double> const& temperatures() const { return _temperatures; }
+
+        /** Counters of the temperatures in ascending order
+         */
+        std::vector<level> const& levels() const { return _levels; }
+
+        /** The replica currently running at the temperature @p l
+         */
+        search const& replica_at(std::size_t l) const { return *_replicas[_replica_at[l]]; }
+
+        /** The replica which started at the temperature @p i, it keeps its own counters of
+         * evaluated and accepted neighbours at whichever temperatures it ran
+         */
+        search const& replica(std::size_t i) const { return *_replicas[i]; }
+
+        std::uint64_t num_of_evaluations() const {
+            std::uint64_t sum = 0;
+            for (auto const& replica : _replicas)
+                sum += replica->num_of_evaluations();
+            return sum;
+        }
+
+        std::uint64_t num_of_skipped_evaluations() const {
+            std::uint64_t sum = 0;
+            for (auto const& replica : _replicas)
+                sum += replica->num_of_skipped_evaluations();
+            return sum;
+        }
+
+    private:
+        Generator _generator;
+        const std::vector<double> _temperatures;
+        thread_pool _pool;
+        std::vector<std::unique_ptr<search>> _replicas;
+        std::vector<std::size_t> _replica_at; // index of the replica at each temperature
+        const std::uint64_t _exchange_interval;
+        std::uint64_t _generation;
+        std::uint64_t _num_of_exchange_rounds;
+        std::vector<level> _levels;
+        std::size_t _champion;
+
+        std::vector<double> _scores;
+
+        static unsigned _num_of_threads(std::vector<double> const& temperatures,
+                                        std::uint64_t exchange_interval,
+                                        unsigned threads) {
+            if (temperatures.empty())
+                throw std::runtime_error("parallel tempering needs at least one temperature");
+            if (temperatures.front() < 0.0 ||
+                !std::is_sorted(temperatures.begin(), temperatures.end()))
+                throw std::runtime_error("the temperatures have to be ascending and nonnegative");
+            if (exchange_interval == 0)
+                throw std::runtime_error("the exchange interval can't be zero");
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::min<std::size_t>(threads, temperatures.size()));
+        }
+
+        // the first of the replicas with the best solution, from the coldest one
+        std::size_t _best() const {
+            std::size_t best = _replica_at[0];
+            for (std::size_t l = 1; l != _replica_at.size(); ++l)
+                if (_replicas[best]->solution() < _replicas[_replica_at[l]]->solution())
+                    best = _replica_at[l];
+            return best;
+        }
+
+        void _exchange() {
+            std::uniform_real_distribution<double> coin;
+            for (std::size_t l = _num_of_exchange_rounds++ % 2; l + 1 < _levels.size(); l += 2) {
+                search& cold = *_replicas[_replica_at[l]];
+                search& hot = *_replicas[_replica_at[l + 1]];
+                const double difference = hot.solution().score - cold.solution().score;
+                ++_levels[l].exchanges_tried;
+
+                // a better hot replica always cools down, at zero temperature only then
+                if (difference < 0.0) {
+                    const double beta = 1.0 / _temperatures[l] - 1.0 / _temperatures[l + 1];
+                    if (!(coin(_generator) < std::exp(beta * difference)))
+                        continue;
+                }
+                ++_levels[l].exchanges_accepted;
+                std::swap(_replica_at[l], _replica_at[l + 1]);
+                cold.set_temperature(_temperatures[l + 1]);
+                hot.set_temperature(_temperatures[l]);
+            }
+        }
+    };
+
+} // namespace solvers
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace solvers {
+
+    /** Fixed group of threads running the same task in parallel.
+     *
+     * The task is called once on every thread with the index of the thread; the calling thread
+     * takes part as thread 0, so a pool of size one runs the task in place and starts no thread.
+     * Independent jobs of unequal length are better spread by run_each().
+     */
+    struct thread_pool {
+        explicit thread_pool(unsigned size)
+            : _size(size != 0 ? size : 1)
+            , _round(0)
+            , _running(0)
+            , _stop(false) {
+            for (unsigned i = 1; i != _size; ++i)
+                _threads.emplace_back([this, i] { _work(i); });
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _wake.notify_all();
+            for (auto& thread : _threads)
+                thread.join();
+        }
+
+        unsigned size() const { return _size; }
+
+        /** Runs @p task(i) on every thread i and waits until all of them finish
+         *
+         * The first exception thrown by the task is rethrown here.
+         */
+        void run(std::function<void(unsigned)> task) {
+            if (_size == 1) {
+                task(0);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _task = std::move(task);
+                _error = nullptr;
+                _running = _size - 1;
+                ++_round;
+            }
+            _wake.notify_all();
+
+            _call(0);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this] { return _running == 0; });
+            _task = nullptr;
+            if (_error)
+                std::rethrow_exception(_error);
+        }
+
+        /** Runs @p job(i) for every i in [0, n) and waits until all of them finish
+         *
+         * Each thread starts with its own contiguous range of jobs. A thread which has run out of
+         * them steals the last job of another thread, so long jobs do not leave threads idle.
+         */
+        void run_each(std::size_t n, std::function<void(std::size_t)> job) {
+            std::vector<_range> ranges(_size);
+            for (unsigned t = 0; t != _size; ++t) {
+                ranges[t].first = n * t / _size;
+                ranges[t].last = n * (t + 1) / _size;
+            }
+
+            run([&](unsigned t) {
+                std::size_t i;
+                while (_take(ranges, t, i))
+                    job(i);
+            });
+        }
+
+    private:
+        struct _range {
+            std::mutex mutex;
+            std::size_t first;
+            std::size_t last;
+        };
+
+        const unsigned _size;
+        std::vector<std::thread> _threads;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::function<void(unsigned)> _task;
+        std::exception_ptr _error;
+        std::uint64_t _round;
+        unsigned _running;
+        bool _stop;
+
+        void _call(unsigned i) {
+            try {
+                _task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error)
+                    _error = std::current_exception();
+            }
+        }
+
+        // takes the next job of thread t or steals the last one of another thread
+        bool _take(std::vector<_range>& ranges, unsigned t, std::size_t& job) {
+            {
+                std::lock_guard<std::mutex> lock(ranges[t].mutex);
+                if (ranges[t].first != ranges[t].last) {
+                    job = ranges[t].first++;
+                    return true;
+                }
+            }
+            for (unsigned v = (t + 1) % _size; v != t; v = (v + 1) % _size) {
+                std::lock_guard<std::mutex> lock(ranges[v].mutex);
+                if (ranges[v].first != ranges[v].last) {
+                    job = --ranges[v].last;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void _work(unsigned i) {
+            std::uint64_t round = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [&] { return _stop || _round != round; });
+                    if (_stop)
+                        return;
+                    round = _round;
+                }
+
+                _call(i);
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_running == 0)
+                    _done.notify_one();
+            }
+        }
+    };
+
+} // namespace solvers
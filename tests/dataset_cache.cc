@@ -0,0 +1,78 @@
+#include "../eacirc/dataset_cache.h"
+#include "../eacirc/file_stream.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <eacirc-core/memory.h>
+#include <fstream>
+
+TEST_CASE("dataset_cache") {
+    const std::string path = "dataset_cache_test";
+    const std::vector<std::uint8_t> data{1, 2, 3, 4, 5, 6, 7, 8};
+
+    {
+        dataset_cache cache{json{{"path", path}, {"size-limit", 1u << 20}}};
+        cache.store("key", data);
+
+        std::vector<std::uint8_t> loaded(data.size());
+        REQUIRE(cache.load("key", loaded));
+        REQUIRE(loaded == data);
+
+        // entries are bound to the key and to the size of the data
+        REQUIRE_FALSE(cache.load("other key", loaded));
+        loaded.resize(data.size() + 1);
+        REQUIRE_FALSE(cache.load("key", loaded));
+
+        // and invalid entries are dropped
+        loaded.resize(data.size());
+        REQUIRE_FALSE(cache.load("key", loaded));
+
+        REQUIRE(cache.hits() == 1);
+        REQUIRE(cache.misses() == 3);
+    }
+
+    {
+        // the size limit is enforced when the cache is opened, which also cleans up
+        dataset_cache cache{json{{"path", path}, {"size-limit", 1u << 20}}};
+        cache.store("key", data);
+        dataset_cache empty{json{{"path", path}, {"size-limit", 0u}}};
+        std::vector<std::uint8_t> loaded(data.size());
+        REQUIRE_FALSE(empty.load("key", loaded));
+    }
+
+    // the last cache has evicted all entries, so the directory is empty
+    std::remove(path.c_str());
+}
+
+TEST_CASE("cached_stream") {
+    const std::string path = "cached_stream_test";
+    const std::string file = "cached_stream_test.bin";
+    {
+        std::ofstream out(file, std::ios::binary);
+        for (unsigned i = 0; i != 64; ++i)
+            out.put(char(i));
+    }
+    const json source{{"type", "file-stream"}, {"path", file}};
+
+    {
+        // the first chunk is in the cache, with contents differing from the source
+        dataset_cache cache{json{{"path", path}, {"size-limit", 1u << 20}}};
+        cache.store("key|chunk:0", std::vector<std::uint8_t>(32, 0xff));
+
+        cached_stream s{std::make_unique<file_stream>(source, 16, 0, 64), cache, "key", 16, 2};
+        for (unsigned i = 0; i != 4; ++i) {
+            vec_view vec = s.next();
+            for (unsigned j = 0; j != 16; ++j)
+                REQUIRE(vec.begin()[j] == (i < 2 ? 0xff : 16 * i + j));
+        }
+
+        // the source passes the first chunk again, but only the missing one is stored
+        REQUIRE(cache.hits() == 1);
+        REQUIRE(cache.misses() == 1);
+        REQUIRE(cache.stores() == 2);
+
+        dataset_cache empty{json{{"path", path}, {"size-limit", 0u}}};
+    }
+
+    std::remove(path.c_str());
+    std::remove(file.c_str());
+}
@@ -0,0 +1,428 @@
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include <catch.hpp>
+#include <pcg/pcg_random.hpp>
+#include <stdexcept>
+
+using test_circuit = circuit::circuit<8, 5, 1>;
+using circuit::fn;
+
+static const circuit::fn_set all_functions{fn::NOP,
+                                          fn::CONS,
+                                          fn::AND,
+                                          fn::NAND,
+                                          fn::OR,
+                                          fn::XOR,
+                                          fn::NOR,
+                                          fn::NOT,
+                                          fn::SHIL,
+                                          fn::SHIR,
+                                          fn::ROTL,
+                                          fn::ROTR,
+                                          fn::MASK};
+
+TEST_CASE("categories_evaluator") {
+    pcg32 g(1);
+
+    // stream a is biased, so the scores differ between circuits
+    dataset a{16, 1000};
+    dataset b{16, 1000};
+    for (auto vec : a)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g() & 0x3f);
+    for (auto vec : b)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+
+    // slightly biased, so the p-values do not underflow
+    dataset c{16, 1000};
+    for (auto vec : c)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g() % 251);
+
+    json config{{"num-of-categories", 8}};
+    circuit::basic_initializer ini{json(), all_functions};
+    circuit::basic_mutator mut{json{{"changes-of-functions", 2},
+                                    {"changes-of-arguments", 2},
+                                    {"changes-of-connectors", 3}},
+                               all_functions};
+
+    SECTION("incremental and memoized evaluation equal full evaluation") {
+        circuit::categories_evaluator<test_circuit> incremental{config};
+        circuit::categories_evaluator<test_circuit> memoized{
+                json{{"num-of-categories", 8}, {"cache-size", 64}}};
+        circuit::categories_evaluator<test_circuit> full{config};
+        incremental.change_datasets(a, b);
+        memoized.change_datasets(a, b);
+        full.change_datasets(a, b);
+
+        test_circuit solution{16};
+        ini.apply(solution, g);
+        double score = incremental.apply(solution);
+        memoized.apply(solution);
+
+        circuit::mutation<test_circuit> changes;
+        for (unsigned i = 0; i != 1000; ++i) {
+            test_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+
+            const double expected = full.apply(neighbour);
+            REQUIRE(incremental.apply(neighbour, changes) == expected);
+            REQUIRE(memoized.apply(neighbour, changes) == expected);
+
+            if (score <= expected) {
+                solution = neighbour;
+                score = expected;
+                incremental.accept();
+                memoized.accept();
+            }
+        }
+
+        REQUIRE(memoized.cache().hits() + memoized.cache().misses() == 1000);
+        REQUIRE(memoized.cache().hits() != 0);
+    }
+
+    SECTION("neutral mutations keep the score and the liveness") {
+        circuit::categories_evaluator<test_circuit> eva{config};
+        eva.change_datasets(a, b);
+
+        test_circuit solution{16};
+        ini.apply(solution, g);
+        const double score = eva.apply(solution);
+
+        circuit::mutation<test_circuit> changes;
+        unsigned neutral = 0;
+        for (unsigned i = 0; i != 1000; ++i) {
+            test_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+
+            test_circuit recomputed = neighbour;
+            recomputed.update_liveness();
+            for (unsigned l = 0; l != test_circuit::y; ++l)
+                for (unsigned s = 0; s != test_circuit::x; ++s)
+                    REQUIRE(neighbour[l][s].used == recomputed[l][s].used);
+
+            if (changes.neutral()) {
+                REQUIRE(eva.apply(neighbour) == score);
+                ++neutral;
+            }
+        }
+        REQUIRE(neutral != 0);
+    }
+
+    SECTION("comparing statistics rejects only worse circuits") {
+        circuit::categories_evaluator<test_circuit> comparing{
+                json{{"num-of-categories", 8}, {"compare-statistics", true}}};
+        circuit::categories_evaluator<test_circuit> full{config};
+        comparing.change_datasets(c, b);
+        full.change_datasets(c, b);
+
+        test_circuit solution{16};
+        ini.apply(solution, g);
+        double score = comparing.apply(solution);
+
+        circuit::mutation<test_circuit> changes;
+        unsigned rejected = 0;
+        for (unsigned i = 0; i != 1000; ++i) {
+            test_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+
+            const double expected = full.apply(neighbour);
+            const double actual = comparing.apply(neighbour, changes);
+            if (actual == comparing.rejected) {
+                REQUIRE(expected < score);
+                ++rejected;
+            } else
+                REQUIRE(actual == expected);
+
+            if (score <= expected) {
+                solution = neighbour;
+                score = expected;
+                comparing.accept();
+            }
+        }
+        REQUIRE(rejected != 0);
+    }
+
+    SECTION("racing rejects only worse circuits and scores the others exactly") {
+        circuit::categories_evaluator<test_circuit> racing{
+                json{{"num-of-categories", 8}, {"racing", json{{"first-fraction", 0.125}}}}};
+        circuit::categories_evaluator<test_circuit> full{config};
+        racing.change_datasets(c, b);
+        full.change_datasets(c, b);
+
+        test_circuit solution{16};
+        ini.apply(solution, g);
+        double score = racing.apply(solution);
+
+        circuit::mutation<test_circuit> changes;
+        for (unsigned i = 0; i != 2000; ++i) {
+            test_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+
+            const double expected = full.apply(neighbour);
+            const double actual = racing.apply(neighbour, changes);
+            if (actual == racing.rejected)
+                REQUIRE(expected < score);
+            else
+                REQUIRE(actual == expected);
+
+            if (score <= expected) {
+                solution = neighbour;
+                score = expected;
+                racing.accept();
+            }
+        }
+        REQUIRE(racing.race().rejections() != 0);
+        REQUIRE(racing.race().consumed_per_rejection() < 1.0);
+    }
+
+    SECTION("evaluation of a population equals evaluation of each circuit") {
+        // b is too large to be cached, so its test vectors are transposed tile by tile
+        dataset large{16, 70000};
+        for (auto vec : large)
+            for (auto& byte : vec)
+                byte = std::uint8_t(g());
+
+        std::vector<test_circuit> population(10, test_circuit{16});
+        for (auto& circuit : population) {
+            ini.apply(circuit, g);
+            mut.apply(circuit, g);
+        }
+        population.push_back(population.front());
+
+        for (dataset const* d : {&b, &large}) {
+            circuit::categories_evaluator<test_circuit> batch{
+                    json{{"num-of-categories", 8}, {"cache-size", 64}}};
+            circuit::categories_evaluator<test_circuit> single{config};
+            batch.change_datasets(a, *d);
+            single.change_datasets(a, *d);
+
+            const double base = batch.apply(population.back());
+            std::vector<double> scores;
+            batch.apply(population.begin(), population.end(), std::back_inserter(scores));
+            REQUIRE(scores.size() == population.size());
+            for (std::size_t i = 0; i != population.size(); ++i)
+                REQUIRE(scores[i] == single.apply(population[i]));
+            REQUIRE(batch.cache().hits() == 2);
+
+            // the base of incremental evaluation is kept
+            circuit::mutation<test_circuit> changes;
+            test_circuit neighbour = population.back();
+            mut.apply(neighbour, g, changes);
+            REQUIRE(batch.apply(neighbour, changes) == single.apply(neighbour));
+            REQUIRE(base == single.apply(population.back()));
+        }
+    }
+
+    SECTION("evaluation in chunks equals evaluation at once") {
+        circuit::categories_evaluator<test_circuit> eva{config};
+        eva.change_datasets(a, b);
+
+        for (unsigned i = 0; i != 20; ++i) {
+            test_circuit circuit{16};
+            ini.apply(circuit, g);
+            mut.apply(circuit, g);
+
+            eva.begin_chunks(circuit);
+            for (std::size_t first = 0; first < 1000; first += 300) {
+                const std::size_t size = std::min<std::size_t>(300, 1000 - first);
+                eva.add_chunks(dataset_view(a).subview(first, size),
+                               dataset_view(b).subview(first, size));
+            }
+            REQUIRE(eva.finish_chunks() == eva.apply(circuit));
+        }
+    }
+
+    SECTION("copies sharing the transposed datasets score as if they were alone") {
+        const circuit::categories_evaluator<test_circuit> prototype{config};
+        auto first = prototype;
+        auto second = prototype;
+        circuit::categories_evaluator<test_circuit> first_alone{config};
+        circuit::categories_evaluator<test_circuit> second_alone{config};
+        first.change_datasets(a, b);
+        first_alone.change_datasets(a, b);
+        // the rows of the first copy stay valid after the second one gets other datasets
+        second.change_datasets(c, b);
+        second_alone.change_datasets(c, b);
+
+        test_circuit solution{16};
+        ini.apply(solution, g);
+        REQUIRE(first.apply(solution) == first_alone.apply(solution));
+        REQUIRE(second.apply(solution) == second_alone.apply(solution));
+
+        circuit::mutation<test_circuit> changes;
+        for (unsigned i = 0; i != 100; ++i) {
+            test_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+            REQUIRE(first.apply(neighbour, changes) == first_alone.apply(neighbour));
+            REQUIRE(second.apply(neighbour, changes) == second_alone.apply(neighbour));
+        }
+    }
+}
+
+TEST_CASE("categories_evaluator of a wider circuit with more outputs") {
+    using wide_circuit = circuit::circuit<16, 6, 2>;
+    pcg32 g(3);
+
+    dataset a{16, 1000};
+    dataset b{16, 1000};
+    for (auto vec : a)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g() & 0x3f);
+    for (auto vec : b)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+
+    json config{{"num-of-categories", 8}};
+    circuit::basic_initializer ini{json(), all_functions};
+    circuit::basic_mutator mut{json{{"changes-of-functions", 2},
+                                    {"changes-of-arguments", 2},
+                                    {"changes-of-connectors", 3}},
+                               all_functions};
+    circuit::categories_evaluator<wide_circuit> incremental{config};
+    circuit::categories_evaluator<wide_circuit> full{config};
+    incremental.change_datasets(a, b);
+    full.change_datasets(a, b);
+
+    wide_circuit solution{16};
+    ini.apply(solution, g);
+    double score = incremental.apply(solution);
+
+    circuit::mutation<wide_circuit> changes;
+    for (unsigned i = 0; i != 300; ++i) {
+        wide_circuit neighbour = solution;
+        mut.apply(neighbour, g, changes);
+
+        const double expected = full.apply(neighbour);
+        REQUIRE(incremental.apply(neighbour, changes) == expected);
+        if (score <= expected) {
+            solution = neighbour;
+            score = expected;
+            incremental.accept();
+        }
+    }
+}
+
+TEST_CASE("dynamic_circuit") {
+    pcg32 g(4);
+
+    dataset a{16, 1000};
+    dataset b{16, 1000};
+    for (auto vec : a)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g() & 0x3f);
+    for (auto vec : b)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+
+    json config{{"num-of-categories", 8}};
+    circuit::basic_initializer ini{json(), all_functions};
+    circuit::basic_mutator mut{json{{"changes-of-functions", 2},
+                                    {"changes-of-arguments", 2},
+                                    {"changes-of-connectors", 3}},
+                               all_functions};
+
+    SECTION("a compiled geometry evolves and scores the same as its circuit type") {
+        circuit::categories_evaluator<test_circuit> fixed{config};
+        circuit::categories_evaluator<circuit::dynamic_circuit> dynamic{config};
+        fixed.change_datasets(a, b);
+        dynamic.change_datasets(a, b);
+
+        pcg32 g_fixed(5);
+        pcg32 g_dynamic(5);
+        test_circuit fixed_solution{16};
+        circuit::dynamic_circuit dynamic_solution{16, circuit::runtime_geometry{8, 5, 1}};
+        ini.apply(fixed_solution, g_fixed);
+        ini.apply(dynamic_solution, g_dynamic);
+        double score = fixed.apply(fixed_solution);
+        REQUIRE(dynamic.apply(dynamic_solution) == score);
+
+        circuit::mutation<test_circuit> fixed_changes;
+        circuit::mutation<circuit::dynamic_circuit> dynamic_changes;
+        for (unsigned i = 0; i != 300; ++i) {
+            test_circuit fixed_neighbour = fixed_solution;
+            circuit::dynamic_circuit dynamic_neighbour = dynamic_solution;
+            mut.apply(fixed_neighbour, g_fixed, fixed_changes);
+            mut.apply(dynamic_neighbour, g_dynamic, dynamic_changes);
+
+            const double expected = fixed.apply(fixed_neighbour, fixed_changes);
+            REQUIRE(dynamic.apply(dynamic_neighbour, dynamic_changes) == expected);
+            if (score <= expected) {
+                fixed_solution = fixed_neighbour;
+                dynamic_solution = dynamic_neighbour;
+                score = expected;
+                fixed.accept();
+                dynamic.accept();
+            }
+        }
+
+        for (unsigned l = 0; l != test_circuit::y; ++l) {
+            for (unsigned i = 0; i != test_circuit::x; ++i) {
+                auto const& expected = fixed_solution[l][i];
+                auto const& node = dynamic_solution[l][i];
+                REQUIRE(node.connectors == expected.connectors);
+                REQUIRE(node.function == expected.function);
+                REQUIRE(node.argument == expected.argument);
+                REQUIRE(node.used == expected.used);
+            }
+        }
+    }
+
+    SECTION("incremental evaluation of other geometries equals the full one") {
+        circuit::categories_evaluator<circuit::dynamic_circuit> incremental{config};
+        circuit::categories_evaluator<circuit::dynamic_circuit> full{config};
+        incremental.change_datasets(a, b);
+        full.change_datasets(a, b);
+
+        circuit::dynamic_circuit solution{16, circuit::runtime_geometry{12, 4, 3}};
+        ini.apply(solution, g);
+        double score = incremental.apply(solution);
+
+        circuit::mutation<circuit::dynamic_circuit> changes;
+        for (unsigned i = 0; i != 300; ++i) {
+            circuit::dynamic_circuit neighbour = solution;
+            mut.apply(neighbour, g, changes);
+
+            const double expected = full.apply(neighbour);
+            REQUIRE(incremental.apply(neighbour, changes) == expected);
+            if (score <= expected) {
+                solution = neighbour;
+                score = expected;
+                incremental.accept();
+            }
+        }
+    }
+
+    SECTION("geometries beyond the capacity are refused") {
+        using geometry = circuit::runtime_geometry;
+        REQUIRE_THROWS_AS((circuit::dynamic_circuit{16, geometry{33, 4, 1}}), std::runtime_error);
+        REQUIRE_THROWS_AS((circuit::dynamic_circuit{16, geometry{8, 17, 1}}), std::runtime_error);
+        REQUIRE_THROWS_AS((circuit::dynamic_circuit{16, geometry{4, 4, 5}}), std::runtime_error);
+    }
+}
+
+TEST_CASE("byte_counts") {
+    pcg32 g(2);
+    std::vector<std::uint8_t> from(1001);
+    std::vector<std::uint8_t> to(from.size());
+    for (std::size_t i = 0; i != from.size(); ++i) {
+        from[i] = std::uint8_t(g());
+        // the second half is unchanged, so whole blocks are skipped
+        to[i] = i % 3 == 0 && i < 500 ? std::uint8_t(g()) : from[i];
+    }
+
+    for (std::size_t size : {std::size_t(8), std::size_t(12), std::size_t(512)}) {
+        circuit::byte_counts::histogram expected(size, 0u);
+        for (auto byte : to)
+            expected[byte % size]++;
+
+        circuit::byte_counts counts;
+        counts.add(from.data(), from.size());
+        counts.move(from.data(), to.data(), from.size());
+
+        circuit::byte_counts::histogram h(size, 0u);
+        counts.fold(h);
+        REQUIRE(h == expected);
+    }
+}
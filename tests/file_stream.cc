@@ -0,0 +1,31 @@
+#include "../eacirc/file_stream.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+TEST_CASE("file_stream") {
+    const std::string path = "file_stream_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        for (unsigned i = 0; i != 100; ++i)
+            file.put(char(i));
+    }
+    const json config{{"type", "file-stream"}, {"path", path}};
+
+    SECTION("test vectors follow the file from the first byte") {
+        file_stream s{config, 16, 20, 64};
+        for (unsigned i = 0; i != 4; ++i) {
+            vec_view vec = s.next();
+            REQUIRE(vec.size() == 16);
+            for (unsigned j = 0; j != 16; ++j)
+                REQUIRE(vec.begin()[j] == 20 + 16 * i + j);
+        }
+    }
+
+    SECTION("too short files are refused") {
+        REQUIRE_THROWS_AS((file_stream{config, 16, 20, 96}), std::runtime_error);
+    }
+
+    std::remove(path.c_str());
+}
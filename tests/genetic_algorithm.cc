@@ -0,0 +1,90 @@
+#include "../solvers/genetic_algorithm.h"
+#include "solver_fixture.h"
+#include <catch.hpp>
+
+using test_search = solvers::genetic_algorithm<test_circuit,
+                                               circuit::basic_initializer,
+                                               circuit::basic_mutator,
+                                               circuit::layer_crossover,
+                                               test_evaluator,
+                                               pcg32>;
+using test_search_individual = solvers::individual<test_circuit, double>;
+
+// whether the layers l of the circuits have the same nodes, regardless of their liveness
+static bool same_layer(test_circuit const& a, test_circuit const& b, unsigned l) {
+    for (unsigned i = 0; i != test_circuit::x; ++i)
+        if (a[l][i].connectors != b[l][i].connectors || a[l][i].function != b[l][i].function ||
+            a[l][i].argument != b[l][i].argument)
+            return false;
+    return true;
+}
+
+static std::vector<double> search(dataset const& a, dataset const& b, unsigned threads) {
+    test_search solver{test_circuit{16},
+                       make_initializer(),
+                       make_mutator(),
+                       circuit::layer_crossover{json()},
+                       make_evaluator(),
+                       seed_seq_from<pcg32>(7u),
+                       16,
+                       8,
+                       2,
+                       3,
+                       threads};
+
+    solver.reevaluate(a, b);
+    const double score = solver.run(50);
+    REQUIRE(solver.num_of_evaluations() == 50 * 8);
+
+    auto population = solver.population();
+    REQUIRE(population.size() == 16);
+    REQUIRE(std::is_sorted(
+            population.begin(), population.end(), std::greater<test_search_individual>()));
+    REQUIRE(population.begin()->score == score);
+
+    // the best individual is reevaluated alone, the same as in the population
+    solver.begin_reevaluation();
+    solver.reevaluate_chunk(a, b);
+    REQUIRE(solver.end_reevaluation() == score);
+    REQUIRE(solver.reevaluate(a, b) == score);
+    return {solver.scores().begin(), solver.scores().end()};
+}
+
+TEST_CASE("genetic_algorithm") {
+    dataset a{16, 500};
+    dataset b{16, 500};
+    fill_datasets(a, b, 4);
+
+    SECTION("the elite keeps the best score from decreasing") {
+        const auto scores = search(a, b, 1);
+        REQUIRE(std::is_sorted(scores.begin(), scores.end()));
+        REQUIRE(scores.back() > scores.front());
+    }
+
+    SECTION("the result does not depend on the number of threads") {
+        const auto scores = search(a, b, 1);
+        REQUIRE(search(a, b, 3) == scores);
+        REQUIRE(search(a, b, 8) == scores);
+    }
+}
+
+TEST_CASE("layer_crossover") {
+    pcg32 g(5);
+    circuit::basic_initializer ini{json(), circuit::fn_set{circuit::fn::XOR, circuit::fn::AND}};
+    test_circuit a{16};
+    test_circuit b{16};
+    ini.apply(a, g);
+    ini.apply(b, g);
+
+    circuit::layer_crossover cro{json()};
+    test_circuit child{16};
+    for (unsigned i = 0; i != 20; ++i) {
+        cro.apply(a, b, child, g);
+        for (unsigned l = 0; l != test_circuit::y; ++l)
+            REQUIRE((same_layer(child, a, l) || same_layer(child, b, l)));
+
+        test_circuit recomputed = child;
+        recomputed.update_liveness();
+        REQUIRE(recomputed == child);
+    }
+}
@@ -0,0 +1,98 @@
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include "../eacirc/circuit/interpreter.h"
+#include "../eacirc/circuit/program.h"
+#include <catch.hpp>
+#include <pcg/pcg_random.hpp>
+#include <vector>
+
+using test_circuit = circuit::circuit<8, 5, 2>;
+using circuit::fn;
+
+static const circuit::fn_set all_functions{fn::NOP,
+                                          fn::CONS,
+                                          fn::AND,
+                                          fn::NAND,
+                                          fn::OR,
+                                          fn::XOR,
+                                          fn::NOR,
+                                          fn::NOT,
+                                          fn::SHIL,
+                                          fn::SHIR,
+                                          fn::ROTL,
+                                          fn::ROTR,
+                                          fn::MASK};
+
+static dataset random_dataset(pcg32& g, std::size_t tv_size, std::size_t num_of_tvs) {
+    dataset data{tv_size, num_of_tvs};
+    for (auto vec : data)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+    return data;
+}
+
+template <typename Output>
+static bool same(std::vector<Output> const& lhs, std::vector<Output> const& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](Output const& l, Output const& r) {
+        return std::equal(l.begin(), l.end(), r.begin());
+    });
+}
+
+// runs the program over the dataset in batches of the given number of lanes
+static std::vector<test_circuit::output>
+run(circuit::program<test_circuit> const& prog, dataset const& data, std::size_t lanes) {
+    std::vector<std::uint8_t> registers(prog.num_of_registers() * lanes);
+    std::vector<test_circuit::output> outputs;
+
+    auto it = data.begin();
+    for (std::size_t left = data.num_of_tvs(); left != 0;) {
+        const std::size_t n = std::min(left, lanes);
+        it = circuit::transpose(it, n, prog.input(), registers.data(), lanes);
+        prog.execute(registers.data(), lanes, lanes);
+
+        for (std::size_t lane = 0; lane != n; ++lane) {
+            test_circuit::output vec;
+            for (unsigned i = 0; i != vec.size(); ++i)
+                vec[i] = registers[prog.output_register(i) * lanes + lane];
+            outputs.emplace_back(vec);
+        }
+        left -= n;
+    }
+    return outputs;
+}
+
+TEST_CASE("program") {
+    pcg32 g(7);
+    const unsigned tv_size = 16;
+
+    // 1000 test vectors do not fill the last batch of any lane width
+    dataset data = random_dataset(g, tv_size, 1000);
+
+    circuit::basic_initializer ini{json(), all_functions};
+    circuit::basic_mutator mut{json{{"changes-of-functions", 4},
+                                    {"changes-of-arguments", 4},
+                                    {"changes-of-connectors", 6}},
+                               all_functions};
+
+    test_circuit circ{tv_size};
+    ini.apply(circ, g);
+
+    circuit::program<test_circuit> prog;
+
+    for (unsigned round = 0; round != 200; ++round) {
+        mut.apply(circ, g);
+        prog.compile(circ);
+
+        std::vector<test_circuit::output> expected;
+        std::transform(data.begin(), data.end(), std::back_inserter(expected),
+                       circuit::interpreter<test_circuit>{circ});
+
+        auto out16 = run(prog, data, 16);
+        auto out64 = run(prog, data, 64);
+
+        REQUIRE(out16.size() == expected.size());
+        REQUIRE(out64.size() == expected.size());
+        REQUIRE(same(out16, expected));
+        REQUIRE(same(out64, expected));
+    }
+}
@@ -0,0 +1,55 @@
+#include "../solvers/island_model.h"
+#include "solver_fixture.h"
+#include <catch.hpp>
+
+using test_search = solvers::island_model<test_circuit,
+                                          circuit::basic_initializer,
+                                          circuit::basic_mutator,
+                                          test_evaluator,
+                                          pcg32>;
+
+static std::vector<double> search(dataset const& a, dataset const& b, unsigned threads) {
+    test_search solver{test_circuit{16},
+                       make_initializer(),
+                       make_mutator(),
+                       make_evaluator(),
+                       seed_seq_from<pcg32>(7u),
+                       4,
+                       25,
+                       1,
+                       threads,
+                       true};
+
+    solver.reevaluate(a, b);
+    // the migration interval is not a divisor, so it spans the calls
+    double score = solver.run(60);
+    score = solver.run(140);
+    REQUIRE(solver.num_of_migrations() != 0);
+
+    // an island holds the best solution and the islands keep their evaluators on their solutions
+    double best = 0.0;
+    for (std::size_t i = 0; i != solver.num_of_islands(); ++i)
+        best = std::max(best, solver.island(i).solution().score);
+    REQUIRE(best == score);
+    REQUIRE(solver.reevaluate(a, b) == score);
+    for (std::size_t i = 0; i != solver.num_of_islands(); ++i) {
+        test_circuit const& circuit = solver.island(i).solution().genotype;
+        test_evaluator eva = make_evaluator();
+        eva.change_datasets(a, b);
+        REQUIRE(eva.apply(circuit) == solver.island(i).solution().score);
+    }
+    return {solver.scores().begin(), solver.scores().end()};
+}
+
+TEST_CASE("island_model") {
+    dataset a{16, 500};
+    dataset b{16, 500};
+    fill_datasets(a, b, 6);
+
+    SECTION("the result does not depend on the number of threads") {
+        const auto scores = search(a, b, 1);
+        REQUIRE(std::is_sorted(scores.begin(), scores.end()));
+        REQUIRE(search(a, b, 2) == scores);
+        REQUIRE(search(a, b, 4) == scores);
+    }
+}
@@ -0,0 +1,44 @@
+#include "../solvers/local_search.h"
+#include "solver_fixture.h"
+#include <catch.hpp>
+
+using test_search = solvers::local_search<test_circuit,
+                                          circuit::basic_initializer,
+                                          circuit::basic_mutator,
+                                          test_evaluator,
+                                          pcg32>;
+
+static std::vector<double>
+search(dataset const& a, dataset const& b, std::size_t neighbours, unsigned threads, bool undo) {
+    test_search solver{test_circuit{16},
+                       make_initializer(),
+                       make_mutator(),
+                       make_evaluator(),
+                       seed_seq_from<pcg32>(7u),
+                       neighbours,
+                       threads,
+                       undo};
+
+    solver.reevaluate(a, b);
+    const double score = solver.run(200);
+    // the evaluators of all threads have to follow the accepted neighbours
+    REQUIRE(solver.reevaluate(a, b) == score);
+    return {solver.scores().begin(), solver.scores().end()};
+}
+
+TEST_CASE("local_search") {
+    dataset a{16, 500};
+    dataset b{16, 500};
+    fill_datasets(a, b, 3);
+
+    SECTION("the result does not depend on the number of threads") {
+        const auto scores = search(a, b, 5, 1, false);
+        REQUIRE(std::is_sorted(scores.begin(), scores.end()));
+        REQUIRE(search(a, b, 5, 2, false) == scores);
+        REQUIRE(search(a, b, 5, 5, false) == scores);
+    }
+
+    SECTION("mutating the solution in place equals mutating its copy") {
+        REQUIRE(search(a, b, 1, 1, true) == search(a, b, 1, 1, false));
+    }
+}
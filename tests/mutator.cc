@@ -0,0 +1,48 @@
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include <catch.hpp>
+#include <pcg/pcg_random.hpp>
+
+using test_circuit = circuit::circuit<8, 5, 2>;
+using circuit::fn;
+
+TEST_CASE("basic_mutator undo log") {
+    pcg32 g(4);
+
+    const circuit::fn_set functions{fn::NOP,
+                                    fn::CONS,
+                                    fn::AND,
+                                    fn::NAND,
+                                    fn::OR,
+                                    fn::XOR,
+                                    fn::NOR,
+                                    fn::NOT,
+                                    fn::SHIL,
+                                    fn::MASK};
+    circuit::basic_initializer ini{json(), functions};
+    circuit::basic_mutator mut{json{{"changes-of-functions", 3},
+                                    {"changes-of-arguments", 3},
+                                    {"changes-of-connectors", 4}},
+                               functions};
+
+    test_circuit solution{12};
+    ini.apply(solution, g);
+
+    circuit::mutation<test_circuit> changes;
+    changes.keep_undo_log(true);
+
+    for (unsigned i = 0; i != 2000; ++i) {
+        const test_circuit original = solution;
+        mut.apply(solution, g, changes);
+
+        // keep every other mutation, so that rollbacks happen on various circuits
+        if (i % 2 == 0) {
+            changes.rollback(solution);
+            REQUIRE(solution == original);
+        } else {
+            test_circuit fresh = solution;
+            fresh.update_liveness();
+            REQUIRE(solution == fresh);
+        }
+    }
+}
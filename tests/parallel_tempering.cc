@@ -0,0 +1,81 @@
+#include "../solvers/parallel_tempering.h"
+#include "solver_fixture.h"
+#include <catch.hpp>
+#include <stdexcept>
+
+using test_search = solvers::parallel_tempering<test_circuit,
+                                                circuit::basic_initializer,
+                                                circuit::basic_mutator,
+                                                test_evaluator,
+                                                pcg32>;
+
+static std::vector<double> search(dataset const& a, dataset const& b, unsigned threads) {
+    test_search solver{test_circuit{16},
+                       make_initializer(),
+                       make_mutator(),
+                       make_evaluator(),
+                       seed_seq_from<pcg32>(7u),
+                       {0.0, 0.01, 0.1},
+                       10,
+                       threads,
+                       true};
+
+    solver.reevaluate(a, b);
+    const double score = solver.run(200);
+
+    auto const& levels = solver.levels();
+    REQUIRE(levels.size() == 3);
+    // hotter replicas accept more of their neighbours
+    auto rate = [](std::uint64_t part, std::uint64_t whole) { return double(part) / whole; };
+    REQUIRE(rate(levels[0].accepted, levels[0].evaluated) <
+            rate(levels[2].accepted, levels[2].evaluated));
+    REQUIRE(levels[0].exchanges_tried + levels[1].exchanges_tried == 20);
+    REQUIRE(levels[0].exchanges_accepted + levels[1].exchanges_accepted != 0);
+
+    // in total, the replicas count the same neighbours as the temperatures they ran at
+    std::uint64_t by_levels = 0;
+    std::uint64_t by_replicas = 0;
+    for (std::size_t i = 0; i != levels.size(); ++i) {
+        by_levels += levels[i].accepted;
+        by_replicas += solver.replica(i).num_of_accepted();
+    }
+    REQUIRE(by_replicas == by_levels);
+
+    // the replicas swap temperatures, not solutions, so their evaluators follow them
+    for (std::size_t l = 0; l != levels.size(); ++l) {
+        auto const& replica = solver.replica_at(l);
+        REQUIRE(replica.temperature() == solver.temperatures()[l]);
+        test_evaluator eva = make_evaluator();
+        eva.change_datasets(a, b);
+        REQUIRE(eva.apply(replica.solution().genotype) == replica.solution().score);
+    }
+    REQUIRE(solver.reevaluate(a, b) == score);
+    return {solver.scores().begin(), solver.scores().end()};
+}
+
+TEST_CASE("parallel_tempering") {
+    dataset a{16, 500};
+    dataset b{16, 500};
+    fill_datasets(a, b, 8);
+
+    SECTION("the result does not depend on the number of threads") {
+        const auto scores = search(a, b, 1);
+        REQUIRE(search(a, b, 2) == scores);
+        REQUIRE(search(a, b, 3) == scores);
+    }
+}
+
+TEST_CASE("parallel_tempering refuses inexact scores at positive temperatures") {
+    const json config{{"num-of-categories", 8}, {"compare-statistics", true}};
+    auto make = [&](std::vector<double> temperatures) {
+        test_search{test_circuit{16},
+                    make_initializer(),
+                    make_mutator(),
+                    test_evaluator{config},
+                    seed_seq_from<pcg32>(7u),
+                    std::move(temperatures),
+                    10};
+    };
+    REQUIRE_NOTHROW(make({0.0}));
+    REQUIRE_THROWS_AS(make({0.0, 0.1}), std::runtime_error);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../eacirc/circuit/circuit.h"
+#include "../eacirc/circuit/genetics.h"
+#include <pcg/pcg_random.hpp>
+
+/** Setup shared by the tests of the solvers: a small circuit with its genetic operators, and
+ * datasets of skewed and of uniform bytes which the solvers learn to tell apart.
+ */
+using test_circuit = circuit::circuit<8, 5, 1>;
+using test_evaluator = circuit::categories_evaluator<test_circuit>;
+
+inline circuit::fn_set test_functions() {
+    return circuit::fn_set{circuit::fn::XOR,
+                           circuit::fn::AND,
+                           circuit::fn::NOT,
+                           circuit::fn::SHIL,
+                           circuit::fn::MASK};
+}
+
+inline circuit::basic_initializer make_initializer() {
+    return circuit::basic_initializer{json(), test_functions()};
+}
+
+inline circuit::basic_mutator make_mutator() {
+    return circuit::basic_mutator{json{{"changes-of-functions", 2},
+                                       {"changes-of-arguments", 2},
+                                       {"changes-of-connectors", 3}},
+                                  test_functions()};
+}
+
+inline test_evaluator make_evaluator() {
+    return test_evaluator{json{{"num-of-categories", 8}}};
+}
+
+// fills @p a with bytes below 128 and @p b with uniform bytes
+inline void fill_datasets(dataset& a, dataset& b, std::uint64_t seed) {
+    pcg32 g(seed);
+    for (auto vec : a)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g() & 0x7f);
+    for (auto vec : b)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+}
@@ -0,0 +1,133 @@
+#include "../eacirc/statistics.h"
+#include <algorithm>
+#include <catch.hpp>
+#include <eacirc-core/dataset.h>
+#include <pcg/pcg_random.hpp>
+
+TEST_CASE("chisqr") {
+    SECTION("closed forms agree with the incomplete gamma function") {
+        for (int dof = 1; dof <= 64; ++dof) {
+            for (double value = 0.0; value < 1500.0; value += 0.37) {
+                const double expected = chisqr_incog(dof, value);
+                if (expected < 1e-200)
+                    break;
+                REQUIRE(std::fabs(chisqr(dof, value) - expected) <= 1e-12 * expected);
+            }
+        }
+    }
+
+    SECTION("p-values match precomputed references") {
+        // computed in 60 digits precision
+        REQUIRE(chisqr(7, 9.3) == Approx(0.23182885825197798).epsilon(1e-14));
+        REQUIRE(chisqr(199, 200.91) == Approx(0.44874471518127926).epsilon(1e-14));
+        REQUIRE(chisqr(256, 250.0) == Approx(0.59395831726374997).epsilon(1e-13));
+        REQUIRE(chisqr(512, 530.2) == Approx(0.27997305469928109).epsilon(1e-13));
+        REQUIRE(chisqr(4, 1300.0) == Approx(3.3278807185719027e-280).epsilon(1e-12));
+        REQUIRE(chisqr(2, 0.0) == 1.0);
+        REQUIRE(chisqr(0, 5.0) == 1.0);
+    }
+
+    SECTION("p-values decrease with the statistic") {
+        for (int dof : {1, 2, 7, 255, 511}) {
+            double last = 1.0;
+            for (double value = 0.0; value < 4.0 * dof; value += 0.25) {
+                const double p = chisqr(dof, value);
+                REQUIRE(p <= last);
+                last = p;
+            }
+        }
+    }
+}
+
+TEST_CASE("two_sample_chisqr") {
+    const std::vector<std::uint64_t> a{10, 20, 30, 3, 40};
+    const std::vector<std::uint64_t> b{20, 10, 30, 2, 45};
+
+    // the fourth category is too small to count
+    const auto statistic = two_sample_chisqr::statistic(a, b);
+    REQUIRE(statistic.dof == 3);
+    REQUIRE(statistic.value == Approx(100.0 / 30 + 100.0 / 30 + 25.0 / 85));
+    REQUIRE(two_sample_chisqr::compute(a, b) == statistic.pvalue());
+}
+
+TEST_CASE("two_sample_chisqr of datasets") {
+    pcg32 g(4);
+    dataset a{16, 300};
+    dataset b{16, 300};
+    // a skewed distribution, half of the bytes are zeros
+    for (auto vec : a)
+        for (auto& byte : vec)
+            byte = g() & 1 ? std::uint8_t(g()) : 0u;
+    for (auto vec : b)
+        for (auto& byte : vec)
+            byte = std::uint8_t(g());
+
+    for (std::size_t categories : {std::size_t(8), std::size_t(12)}) {
+        std::vector<std::uint64_t> histogram_a(categories);
+        std::vector<std::uint64_t> histogram_b(categories);
+        for (auto vec : a)
+            for (std::uint8_t byte : vec)
+                histogram_a[byte % categories]++;
+        for (auto vec : b)
+            for (std::uint8_t byte : vec)
+                histogram_b[byte % categories]++;
+
+        two_sample_chisqr test{categories};
+        REQUIRE(test(a, b) == two_sample_chisqr::compute(histogram_a, histogram_b));
+    }
+}
+
+TEST_CASE("sequential_ks_test") {
+    pcg32 g(5);
+    std::uniform_real_distribution<double> uniform;
+
+    SECTION("p-values of a distinguisher are rejected at the first look") {
+        sequential_ks_test test{300, 1};
+        std::vector<double> pvalues;
+        while (pvalues.size() != 35) {
+            pvalues.emplace_back(uniform(g) * 1e-3);
+            REQUIRE(test.look(pvalues) == sequential_ks_test::decision::undecided);
+        }
+        pvalues.emplace_back(0.0);
+        REQUIRE(test.look(pvalues) == sequential_ks_test::decision::rejected);
+    }
+
+    SECTION("uniform p-values are accepted once no later look can reject") {
+        sequential_ks_test test{300, 1};
+        std::vector<double> pvalues;
+        auto decision = sequential_ks_test::decision::undecided;
+        while (decision == sequential_ks_test::decision::undecided) {
+            pvalues.emplace_back(uniform(g));
+            decision = test.look(pvalues);
+        }
+        REQUIRE(decision == sequential_ks_test::decision::accepted);
+        REQUIRE(pvalues.size() < 300);
+
+        // even if all the remaining p-values are zeros, no look rejects
+        while (pvalues.size() != 300) {
+            pvalues.emplace_back(0.0);
+            REQUIRE(test.look(pvalues) == sequential_ks_test::decision::accepted);
+        }
+    }
+
+    SECTION("the last look decides as the regular KS test") {
+        // slightly too low p-values, the regular test rejects them only at the full size
+        std::vector<double> all;
+        for (std::size_t i = 0; i != 300; ++i)
+            all.emplace_back(0.89 * (i + 0.5) / 300);
+        std::shuffle(all.begin(), all.end(), g);
+
+        sequential_ks_test test{300, 1};
+        std::vector<double> pvalues;
+        auto decision = sequential_ks_test::decision::undecided;
+        while (decision == sequential_ks_test::decision::undecided) {
+            pvalues.emplace_back(all[pvalues.size()]);
+            decision = test.look(pvalues);
+        }
+        REQUIRE(pvalues.size() == 300);
+        REQUIRE(decision == sequential_ks_test::decision::rejected);
+
+        ks_uniformity_test regular{pvalues, 1};
+        REQUIRE(regular.test_statistic > regular.critical_value);
+    }
+}
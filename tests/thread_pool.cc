@@ -0,0 +1,29 @@
+#include "../solvers/thread_pool.h"
+#include <atomic>
+#include <catch.hpp>
+#include <stdexcept>
+
+TEST_CASE("thread_pool") {
+    solvers::thread_pool pool{3};
+
+    SECTION("run_each runs every job exactly once") {
+        std::vector<std::atomic<unsigned>> runs(1000);
+        for (auto& r : runs)
+            r = 0;
+        pool.run_each(runs.size(), [&](std::size_t i) { ++runs[i]; });
+        for (auto const& r : runs)
+            REQUIRE(r == 1u);
+    }
+
+    SECTION("exceptions are passed to the caller") {
+        REQUIRE_THROWS_AS(pool.run([](unsigned i) {
+            if (i == 2)
+                throw std::runtime_error("failed");
+        }),
+                          std::runtime_error);
+
+        std::atomic<unsigned> calls{0};
+        pool.run([&](unsigned) { ++calls; });
+        REQUIRE(calls == 3u);
+    }
+}